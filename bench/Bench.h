@@ -0,0 +1,147 @@
+#ifndef LRPARSER_BENCH_H
+#define LRPARSER_BENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+#include "src/grammar/GrammarReader.h"
+#include "src/parser/LRParser.h"
+
+namespace bench {
+
+// Benchmarks. Each one parses its own arguments.
+int parallel(int argc, char **argv);
+int bitset(int argc, char **argv);
+int closure(int argc, char **argv);
+int sets(int argc, char **argv);
+int transform(int argc, char **argv);
+int ll(int argc, char **argv);
+int semantic(int argc, char **argv);
+int incremental(int argc, char **argv);
+
+// Bytes allocated with operator new by the whole program. They are only
+// counted between start() and stop(), see HeapStats.cpp.
+struct HeapStats {
+    static void start();
+    static void stop();
+    // Largest increase of the live bytes since start().
+    static size_t peak();
+    // Calls to operator new since start().
+    static size_t allocations();
+};
+
+// Wall clock time of `f()` in milliseconds. The best of `repeat` runs is
+// returned.
+template <class F> double timeMilli(F &&f, int repeat = 3) {
+    double best = 0;
+    for (int i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double, std::milli> d =
+            std::chrono::steady_clock::now() - start;
+        if (i == 0 || d.count() < best)
+            best = d.count();
+    }
+    return best;
+}
+
+inline gram::Grammar grammarFromString(std::string const &rules) {
+    std::istringstream stream(rules);
+    return gram::GrammarReader::parse(stream).calAttributes();
+}
+
+// An expression grammar with `levels` binary operators of different
+// precedence. Its LR(1) NFA grows quadratically with `levels`.
+inline std::string precedenceGrammar(int levels) {
+    std::string rules = "prog -> prog stmt | stmt\n"
+                        "stmt -> ID = e0 ; | { prog } | if ( e0 ) stmt\n";
+    for (int i = 0; i < levels; ++i) {
+        auto e = "e" + std::to_string(i), next = "e" + std::to_string(i + 1);
+        rules += e + " -> " + e + " op" + std::to_string(i) + " " + next +
+                 " | " + next + "\n";
+    }
+    auto last = "e" + std::to_string(levels);
+    rules += last + " -> ID | NUM | ( e0 ) | ID ( args )\n";
+    rules += "args -> args , e0 | e0\n";
+    return rules;
+}
+
+// A small statement language. randomProgram() generates inputs for it, and
+// for any grammar with the same terminals.
+constexpr const char *programRules = R"(
+prog -> prog stmt | stmt
+stmt -> ID = exp ; | { prog } | if ( exp ) stmt
+exp  -> exp + term | term
+term -> term * fac | fac
+fac  -> ID | NUM | ( exp )
+)";
+
+// A random program of about `count` tokens, ended with "$".
+inline std::vector<SymbolID> randomProgram(gram::Grammar const &g,
+                                                 size_t count) {
+    auto id = [&g](const char *name) { return g.findSymbol(name).id; };
+    SymbolID ID = id("ID"), NUM = id("NUM"), ASSIGN = id("="), SEMI = id(";");
+    SymbolID LB = id("{"), RB = id("}"), IF = id("if"), LP = id("(");
+    SymbolID RP = id(")"), PLUS = id("+"), STAR = id("*");
+
+    std::mt19937 rng(42);
+    std::vector<SymbolID> tokens;
+    tokens.reserve(count + 64);
+    auto exp = [&](auto &self, int depth) -> void {
+        int terms = 1 + static_cast<int>(rng() % 3);
+        for (int i = 0; i < terms; ++i) {
+            if (i)
+                tokens.push_back(rng() % 2 ? PLUS : STAR);
+            if (depth < 3 && rng() % 6 == 0) {
+                tokens.push_back(LP);
+                self(self, depth + 1);
+                tokens.push_back(RP);
+            } else {
+                tokens.push_back(rng() % 2 ? ID : NUM);
+            }
+        }
+    };
+    auto stmt = [&](auto &self, int depth) -> void {
+        auto kind = rng() % 16;
+        if (depth < 4 && kind == 0) {
+            tokens.push_back(LB);
+            for (int i = 0, n = 1 + static_cast<int>(rng() % 8); i < n; ++i)
+                self(self, depth + 1);
+            tokens.push_back(RB);
+        } else if (depth < 4 && kind == 1) {
+            tokens.insert(tokens.end(), {IF, LP});
+            exp(exp, 0);
+            tokens.push_back(RP);
+            self(self, depth + 1);
+        } else {
+            tokens.insert(tokens.end(), {ID, ASSIGN});
+            exp(exp, 0);
+            tokens.push_back(SEMI);
+        }
+    };
+    do {
+        stmt(stmt, 0);
+    } while (tokens.size() < count);
+    tokens.push_back(g.getEndOfInputSymbol().id);
+    return tokens;
+}
+
+// Builds all tables of a parser of type P.
+template <class P> std::unique_ptr<P> buildParser(gram::Grammar const &g) {
+    auto parser = std::make_unique<P>(g);
+    parser->buildNFA();
+    parser->buildDFA();
+    parser->buildParseTable();
+    return parser;
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,93 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "bench/Bench.h"
+
+// Replaces the global operator new and delete of the benchmarks, so that
+// HeapStats can track the live bytes of the whole program. Each block is
+// prefixed with its size.
+
+namespace {
+
+constexpr size_t header_size = alignof(std::max_align_t);
+
+std::atomic<bool> counting{false};
+// Bytes allocated minus bytes freed since start(). Blocks allocated before
+// start() may be freed, so it can be negative.
+std::atomic<std::ptrdiff_t> live{0};
+std::atomic<std::ptrdiff_t> peakLive{0};
+std::atomic<size_t> blocks{0};
+
+void *allocate(size_t size) {
+    auto p = static_cast<unsigned char *>(std::malloc(size + header_size));
+    if (!p)
+        return nullptr;
+    *reinterpret_cast<size_t *>(p) = size;
+    if (counting.load(std::memory_order_relaxed)) {
+        blocks.fetch_add(1, std::memory_order_relaxed);
+        auto delta = static_cast<std::ptrdiff_t>(size);
+        auto now = live.fetch_add(delta, std::memory_order_relaxed) + delta;
+        auto peak = peakLive.load(std::memory_order_relaxed);
+        while (now > peak && !peakLive.compare_exchange_weak(
+                                 peak, now, std::memory_order_relaxed))
+            ;
+    }
+    return p + header_size;
+}
+
+void deallocate(void *ptr) {
+    if (!ptr)
+        return;
+    auto p = static_cast<unsigned char *>(ptr) - header_size;
+    if (counting.load(std::memory_order_relaxed))
+        live.fetch_sub(
+            static_cast<std::ptrdiff_t>(*reinterpret_cast<size_t *>(p)),
+            std::memory_order_relaxed);
+    std::free(p);
+}
+
+} // namespace
+
+void bench::HeapStats::start() {
+    live = 0;
+    peakLive = 0;
+    blocks = 0;
+    counting = true;
+}
+
+void bench::HeapStats::stop() { counting = false; }
+
+size_t bench::HeapStats::peak() {
+    return static_cast<size_t>(peakLive.load());
+}
+
+size_t bench::HeapStats::allocations() { return blocks.load(); }
+
+void *operator new(size_t size) {
+    if (auto p = allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, std::nothrow_t const &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](size_t size, std::nothrow_t const &) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept { deallocate(p); }
+void operator delete[](void *p) noexcept { deallocate(p); }
+void operator delete(void *p, size_t) noexcept { deallocate(p); }
+void operator delete[](void *p, size_t) noexcept { deallocate(p); }
+void operator delete(void *p, std::nothrow_t const &) noexcept {
+    deallocate(p);
+}
+void operator delete[](void *p, std::nothrow_t const &) noexcept {
+    deallocate(p);
+}
@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "src/util/BitKernels.h"
+#include "src/util/BitSet.h"
+
+using util::kernels::Level;
+
+namespace {
+
+using Set = util::BitSet<int>;
+
+// Results of one round of every operation. They must not depend on the
+// kernel level.
+struct Checksum {
+    size_t hash = 0;
+    size_t count = 0;
+
+    bool operator!=(Checksum const &other) const {
+        return hash != other.hash || count != other.count;
+    }
+};
+
+// `n` sets of `bits` bits. Pairs (2i, 2i + 1) are equal in half of the cases,
+// so that == and subsetOf() do not always return early.
+std::vector<Set> generate(size_t n, size_t bits, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<Set> sets(n, Set(bits));
+    for (size_t i = 0; i < n; ++i) {
+        if (i % 2 && rng() % 2) {
+            sets[i] = sets[i - 1];
+            continue;
+        }
+        for (size_t k = 0, m = bits / 16; k < m; ++k)
+            sets[i].insert(static_cast<int>(rng() % bits));
+    }
+    return sets;
+}
+
+} // namespace
+
+// Arguments: [rounds (default: 20)]
+int bench::bitset(int argc, char **argv) {
+    int rounds = argc > 0 ? std::atoi(argv[0]) : 20;
+    if (rounds <= 0) {
+        fprintf(stderr, "Illegal arguments\n");
+        return 1;
+    }
+
+    auto best = util::kernels::bestLevel();
+    printf("Best kernels: %s\n\n", util::kernels::levelName(best));
+    printf("%6s %-7s %9s %9s %9s %9s %9s %9s\n", "bits", "kernels", "or",
+           "and", "==", "inter", "subset", "hash");
+
+    for (size_t bits : {2048, 16384, 65536}) {
+        size_t n = (size_t{1} << 24) / bits;
+        auto sets = generate(n, bits, 42);
+        Checksum expected;
+        for (int l = 0; l <= static_cast<int>(best); ++l) {
+            auto level = static_cast<Level>(l);
+            util::kernels::setLevel(level);
+            Checksum sum;
+            // Each column is ns per operation.
+            auto perOp = [&](auto &&f) {
+                double ms = timeMilli([&] {
+                    for (int r = 0; r < rounds; ++r)
+                        f();
+                });
+                return ms * 1e6 / (rounds * (n / 2));
+            };
+
+            // |= and &= are idempotent, so repeated rounds give the same sets.
+            auto work = sets;
+            double orTime = perOp([&] {
+                for (size_t i = 0; i + 1 < n; i += 2)
+                    work[i] |= sets[i + 1];
+            });
+            for (size_t i = 0; i + 1 < n; i += 2)
+                sum.hash += std::hash<Set>()(work[i]);
+            work = sets;
+            double andTime = perOp([&] {
+                for (size_t i = 0; i + 1 < n; i += 2)
+                    work[i] &= sets[i + 1];
+            });
+            for (size_t i = 0; i + 1 < n; i += 2)
+                sum.hash += std::hash<Set>()(work[i]);
+            double eqTime = perOp([&] {
+                for (size_t i = 0; i + 1 < n; i += 2)
+                    sum.count += sets[i] == sets[i + 1];
+            });
+            double interTime = perOp([&] {
+                for (size_t i = 0; i + 1 < n; i += 2)
+                    sum.count += sets[i].hasIntersection(sets[i + 1]);
+            });
+            double subsetTime = perOp([&] {
+                for (size_t i = 0; i + 1 < n; i += 2)
+                    sum.count += sets[i].subsetOf(sets[i + 1]);
+            });
+            double hashTime = perOp([&] {
+                for (size_t i = 0; i + 1 < n; i += 2)
+                    sum.hash += std::hash<Set>()(sets[i]);
+            });
+
+            if (l == 0)
+                expected = sum;
+            printf("%6zu %-7s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f%s\n", bits,
+                   util::kernels::levelName(level), orTime, andTime, eqTime,
+                   interTime, subsetTime, hashTime,
+                   sum != expected ? "  (result differs!)" : "");
+        }
+    }
+    printf("\nTimes are ns per operation.\n");
+    util::kernels::setLevel(best);
+    return 0;
+}
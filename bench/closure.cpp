@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+#include "bench/Bench.h"
+#include "src/parser/LALRParser.h"
+#include "src/parser/LR1Parser.h"
+#include "src/util/AllocStats.h"
+
+using namespace gram;
+
+namespace {
+
+// Runs f() once, and prints its time and the BitSet allocations it made.
+template <class F> void measure(const char *name, F &&f) {
+    util::AllocStats::reset();
+    double ms = bench::timeMilli(f, 1);
+    if (util::AllocStats::enabled())
+        printf("%-20s %10.2f ms %10zu allocations\n", name, ms,
+               util::AllocStats::bitSetBlocks.load());
+    else
+        printf("%-20s %10.2f ms\n", name, ms);
+}
+
+} // namespace
+
+// Arguments: [levels (default: 40)]
+int bench::closure(int argc, char **argv) {
+    int levels = argc > 0 ? std::atoi(argv[0]) : 40;
+    if (levels <= 0) {
+        fprintf(stderr, "Illegal arguments\n");
+        return 1;
+    }
+
+    const char *setName =
+        std::is_same_v<Closure, util::BitSet<StateID>>         ? "bitset"
+        : std::is_same_v<Closure, util::HashedBitSet<StateID>> ? "hashed"
+                                                               : "hybrid";
+    printf("Closure set: %s\n", setName);
+    if (!util::AllocStats::enabled())
+        printf("Allocations are only counted in debug builds.\n");
+
+    auto rules = precedenceGrammar(levels);
+    std::optional<Grammar> g;
+    measure("Grammar attributes", [&] { g.emplace(grammarFromString(rules)); });
+    LR1Parser parser(*g);
+    measure("LR(1) buildNFA", [&] { parser.buildNFA(); });
+    measure("LR(1) buildDFA", [&] { parser.buildDFA(); });
+    LALRParser lalr(*g);
+    lalr.buildNFA();
+    measure("LALR(1) buildDFA", [&] { lalr.buildDFA(); });
+
+    auto const &closures = parser.getDFA().getClosures();
+    size_t elements = 0, bytes = 0;
+    for (auto const &closure : closures) {
+        elements += closure.count();
+        bytes += sizeof(Closure) + closure.memoryUsage();
+    }
+    printf("\nLR(1) NFA states: %zu, DFA states: %zu\n",
+           parser.getNFA().getAllStates().size(), closures.size());
+    printf("Closures: %zu elements, %.2f MiB (%.1f bytes per element)\n",
+           elements, bytes / 1048576.0,
+           elements ? static_cast<double>(bytes) / elements : 0.0);
+
+    // Each request served by an arena used to be a call to malloc().
+    printf("\nLR(1) parser arenas: requests, mallocs\n");
+    auto const &blocks = parser.getBlockArena();
+    printf("%-20s %10zu %10zu (%zu reused)\n", "BitSet blocks",
+           blocks.requests(), blocks.chunks(), blocks.reused());
+    auto const &trans = parser.getTransitionArena();
+    printf("%-20s %10zu %10zu\n", "Transitions", trans.requests(),
+           trans.chunks());
+    auto const &labels = parser.getLabelArena();
+    printf("%-20s %10zu %10zu\n", "Labels", labels.requests(),
+           labels.chunks());
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "src/parser/IncrementalParser.h"
+#include "src/parser/LALRParser.h"
+
+using namespace gram;
+
+namespace {
+
+// Production (or token) and width of each node, in pre-order.
+std::vector<std::pair<int, int>> shapeOf(SyntaxTree const &tree) {
+    std::vector<std::pair<int, int>> shape;
+    shape.reserve(tree.size());
+    tree.visit([&](SyntaxTree::NodeID node, int, int) {
+        shape.emplace_back(tree.isLeaf(node) ? -1 - tree.symbolOf(node)
+                                             : tree.productionOf(node),
+                           tree.widthOf(node));
+    });
+    return shape;
+}
+
+} // namespace
+
+// Arguments: [million tokens of the largest input (default: 1)]
+int bench::incremental(int argc, char **argv) {
+    double millions = argc > 0 ? std::atof(argv[0]) : 1;
+    if (millions <= 0) {
+        fprintf(stderr, "Illegal arguments\n");
+        return 1;
+    }
+    auto g = grammarFromString(programRules);
+    auto lr = buildParser<LALRParser>(g);
+    SymbolID ID = g.findSymbol("ID").id, NUM = g.findSymbol("NUM").id;
+    SymbolID PLUS = g.findSymbol("+").id, STAR = g.findSymbol("*").id;
+    constexpr int edits = 100;
+
+    printf("Each edit is undone by the next one. Times are per edit.\n\n");
+    printf("%10s %10s | %10s %8s %8s | %10s %8s %8s | %5s\n", "tokens",
+           "parse ms", "replace us", "shifted", "reused", "insert us",
+           "shifted", "reused", "same");
+    auto largest = static_cast<size_t>(millions * 1e6);
+    for (size_t count = 1000; count <= largest; count *= 10) {
+        auto tokens = randomProgram(g, count);
+        // An operand in the middle: ID and NUM can replace each other, and
+        // "+ NUM" can follow it.
+        size_t at = tokens.size() / 2;
+        while (!(tokens[at] == ID || tokens[at] == NUM) ||
+               !(tokens[at - 1] == PLUS || tokens[at - 1] == STAR))
+            ++at;
+
+        IncrementalParser parser(*lr);
+        double parseTime = timeMilli([&] { parser.parse(tokens); }, 1);
+        bool ok = parser.isValid();
+
+        // Replaces the operand by the other kind of operand.
+        size_t replaceShifted = 0, replaceReused = 0;
+        double replaceTime = timeMilli(
+            [&] {
+                for (int i = 0; i < edits; ++i) {
+                    SymbolID other = parser.getTokens()[at] == ID ? NUM : ID;
+                    ok &= parser.edit(at, at + 1, {other});
+                    replaceShifted += parser.getShiftedTokens();
+                    replaceReused += parser.getReusedNodes();
+                }
+            },
+            1);
+        // Inserts "+ NUM" after the operand, then removes it.
+        size_t insertShifted = 0, insertReused = 0;
+        double insertTime = timeMilli(
+            [&] {
+                for (int i = 0; i < edits; ++i) {
+                    if (i % 2 == 0)
+                        ok &= parser.edit(at + 1, at + 1, {PLUS, NUM});
+                    else
+                        ok &= parser.edit(at + 1, at + 3, {});
+                    insertShifted += parser.getShiftedTokens();
+                    insertReused += parser.getReusedNodes();
+                }
+            },
+            1);
+
+        // The tree must be the one a full parse builds.
+        IncrementalParser fresh(*lr);
+        fresh.parse(parser.getTokens());
+        bool same = ok && shapeOf(parser.getTree()) == shapeOf(fresh.getTree());
+
+        printf("%10zu %10.2f | %10.2f %8zu %8zu | %10.2f %8zu %8zu | %5s\n",
+               tokens.size(), parseTime, replaceTime * 1e3 / edits,
+               replaceShifted / edits, replaceReused / edits,
+               insertTime * 1e3 / edits, insertShifted / edits,
+               insertReused / edits, same ? "yes" : "NO");
+    }
+    return 0;
+}
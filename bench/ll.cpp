@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "src/parser/LALRParser.h"
+#include "src/parser/LLParser.h"
+#include "src/parser/ParseSession.h"
+
+using namespace gram;
+
+namespace {
+
+// programRules without left recursion, which is LL(1).
+const char *llRules = R"(
+prog  -> stmt rest
+rest  -> stmt rest | epsilon
+stmt  -> ID = exp ; | { prog } | if ( exp ) stmt
+exp   -> term exp'
+exp'  -> + term exp' | epsilon
+term  -> fac term'
+term' -> * fac term' | epsilon
+fac   -> ID | NUM | ( exp )
+)";
+
+// Counts the reductions reported by a driver.
+struct Counter : ParseListener {
+    size_t reductions = 0;
+    void onShift(SymbolID) override {}
+    void onReduce(ProductionID, SymbolID, size_t) override { ++reductions; }
+    void onDiscard(size_t) override {}
+};
+
+void report(const char *name, double ms, size_t tokens, size_t reductions,
+            bool accepted) {
+    printf("%-28s %10.2f %10.2f %12zu  accepted=%d\n", name, ms,
+           ms * 1e6 / static_cast<double>(tokens), reductions, accepted);
+}
+
+double sessionTime(LRParser const &lr, std::vector<SymbolID> const &tokens,
+                   size_t &reductions, bool &accepted) {
+    Counter counter;
+    ParseSession counted(lr, &counter);
+    counted.feed(util::Span<SymbolID const>(tokens));
+    reductions = counter.reductions;
+
+    ParseSession session(lr);
+    double ms = bench::timeMilli([&] {
+        session.reset();
+        session.feed(util::Span<SymbolID const>(tokens));
+    });
+    accepted = session.getStatus() == ParseSession::ACCEPTED;
+    return ms;
+}
+
+} // namespace
+
+// Arguments: [million tokens (default: 5)]
+int bench::ll(int argc, char **argv) {
+    double millions = argc > 0 ? std::atof(argv[0]) : 5;
+    if (millions <= 0) {
+        fprintf(stderr, "Illegal arguments\n");
+        return 1;
+    }
+    auto count = static_cast<size_t>(millions * 1e6);
+
+    // Both grammars have the same terminals, so they get the same program.
+    auto llGrammar = grammarFromString(llRules);
+    auto lrGrammar = grammarFromString(programRules);
+    auto llTokens = randomProgram(llGrammar, count);
+    auto lrTokens = randomProgram(lrGrammar, count);
+    printf("Tokens: %zu\n\n", llTokens.size());
+
+    // The LL(1) table needs no automata.
+    printf("%-28s %10s\n", "table", "build ms");
+    std::unique_ptr<LLParser> ll;
+    double llBuild = timeMilli([&] {
+        ll = std::make_unique<LLParser>(llGrammar);
+        ll->buildParseTable();
+    });
+    printf("%-28s %10.3f\n", "LL(1)", llBuild);
+    std::unique_ptr<LALRParser> lalr;
+    double lalrBuild =
+        timeMilli([&] { lalr = buildParser<LALRParser>(llGrammar); });
+    printf("%-28s %10.3f\n", "LALR(1), same grammar", lalrBuild);
+    auto lr = buildParser<LALRParser>(lrGrammar);
+
+    printf("\n%-28s %10s %10s %12s\n", "driver", "ms", "ns/token",
+           "reductions");
+    Counter counter;
+    ll->setListener(&counter);
+    ll->parse(llTokens);
+    ll->setListener(nullptr);
+    bool llOk = false;
+    double llTime = timeMilli([&] { llOk = ll->parse(llTokens); });
+    report("LLParser", llTime, llTokens.size(), counter.reductions, llOk);
+
+    size_t reductions = 0;
+    bool ok = false;
+    double t = sessionTime(*lalr, llTokens, reductions, ok);
+    report("ParseSession, same grammar", t, llTokens.size(), reductions, ok);
+    t = sessionTime(*lr, lrTokens, reductions, ok);
+    report("ParseSession, left-recursive", t, lrTokens.size(), reductions, ok);
+    return 0;
+}
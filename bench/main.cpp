@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+
+#include "bench/Bench.h"
+#include "src/common.h"
+
+LaunchArguments launchArgs;
+
+namespace {
+
+struct Entry {
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *description;
+};
+
+Entry const benchmarks[] = {
+    {"parallel", bench::parallel,
+     "Speculative parallel parsing against the sequential drivers"},
+    {"bitset", bench::bitset,
+     "Bitset bulk operations at each kernel level"},
+    {"closure", bench::closure,
+     "LR(1) subset construction with the configured closure set"},
+    {"sets", bench::sets,
+     "Subset construction with each set type, checked against the parser"},
+    {"transform", bench::transform,
+     "Automaton states saved by the grammar transformations"},
+    {"ll", bench::ll,
+     "LL(1) predictive driver against the LR driver on the same input"},
+    {"semantic", bench::semantic,
+     "Semantic value stack on ParseSession, and its allocations"},
+    {"incremental", bench::incremental,
+     "Reparse time of a one-token edit as the input grows"},
+};
+
+void usage() {
+    fprintf(stderr, "Usage: lrparser_bench <benchmark> [arguments]\n\n");
+    fprintf(stderr, "Benchmarks:\n");
+    for (auto const &entry : benchmarks)
+        fprintf(stderr, "  %-11s: %s\n", entry.name, entry.description);
+}
+
+} // namespace
+
+int main(int argc, char **argv) try {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    // Traces and automatons of the benchmark grammars are not interesting.
+    launchArgs.quiet = true;
+    launchArgs.noSteps = true;
+    launchArgs.logLevel = ERR;
+    launchArgs.resultsDir =
+        (std::filesystem::temp_directory_path() / "lrparser_bench").string();
+    for (auto const &entry : benchmarks) {
+        if (std::strcmp(entry.name, argv[1]) == 0) {
+            lrInit();
+            int code = entry.run(argc - 2, argv + 2);
+            lrCleanUp();
+            return code;
+        }
+    }
+    usage();
+    return 1;
+} catch (std::exception &e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+}
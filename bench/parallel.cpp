@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "src/parser/LALRParser.h"
+#include "src/parser/ParseSession.h"
+#include "src/parser/SpeculativeParser.h"
+
+using namespace gram;
+
+namespace {
+
+// Overwrites `count` random tokens with tokens from other random positions.
+// The final "$" is kept.
+std::vector<SymbolID> mutate(std::vector<SymbolID> tokens, size_t count,
+                             unsigned seed) {
+    std::mt19937 rng(seed);
+    auto n = tokens.size() - 1;
+    for (size_t i = 0; i < count; ++i)
+        tokens[rng() % n] = tokens[rng() % n];
+    return tokens;
+}
+
+// One statement inside `depth` nested "if ( ID )", so that every cut is deep.
+std::vector<SymbolID> nestedProgram(Grammar const &g, size_t depth) {
+    auto id = [&g](const char *name) { return g.findSymbol(name).id; };
+    std::vector<SymbolID> tokens;
+    for (size_t i = 0; i < depth; ++i)
+        tokens.insert(tokens.end(), {id("if"), id("("), id("ID"), id(")")});
+    tokens.insert(tokens.end(), {id("ID"), id("="), id("NUM"), id(";")});
+    tokens.push_back(g.getEndOfInputSymbol().id);
+    return tokens;
+}
+
+} // namespace
+
+// Arguments: [million tokens (default: 10)]
+//            [max threads (default: all, at least 2)]
+int bench::parallel(int argc, char **argv) {
+    double millions = argc > 0 ? std::atof(argv[0]) : 10;
+    // At least one speculative row, even on a single CPU.
+    unsigned maxThreads =
+        argc > 1 ? std::atoi(argv[1])
+                 : std::max(2u, std::thread::hardware_concurrency());
+    if (millions <= 0 || maxThreads == 0) {
+        fprintf(stderr, "Illegal arguments\n");
+        return 1;
+    }
+
+    auto g = grammarFromString(programRules);
+    auto lr = buildParser<LALRParser>(g);
+    auto tokens = randomProgram(g, static_cast<size_t>(millions * 1e6));
+    util::Span<SymbolID const> input(tokens);
+    printf("Tokens: %zu, hardware threads: %u\n", tokens.size(),
+           std::thread::hardware_concurrency());
+
+    ParseSession session(*lr);
+    double sessionTime = timeMilli([&] {
+        session.reset();
+        session.feed(input);
+    });
+    bool sessionOk = session.getStatus() == ParseSession::ACCEPTED;
+    printf("%-24s %10.2f ms  accepted=%d\n", "ParseSession", sessionTime,
+           sessionOk);
+
+    SpeculativeParser speculative(*lr);
+    bool seqOk = false;
+    double seqTime =
+        timeMilli([&] { seqOk = speculative.parseSequential(input); });
+    printf("%-24s %10.2f ms  accepted=%d\n", "Sequential (flat table)",
+           seqTime, seqOk);
+
+    printf("\n%7s %10s %8s %7s %12s %12s\n", "threads", "ms", "speedup",
+           "chunks", "speculated", "sequential");
+    // One thread is the sequential fallback of parse().
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        SpeculativeParser::Options options;
+        options.threads = threads;
+        bool ok = false;
+        double t = timeMilli([&] { ok = speculative.parse(input, options); });
+        printf("%7u %10.2f %7.2fx %7zu %12zu %12zu%s\n", threads, t,
+               seqTime / t, speculative.getChunks(),
+               speculative.getSpeculatedTokens(),
+               speculative.getSequentialTokens(),
+               ok == seqOk ? "" : "  (result differs!)");
+    }
+
+    // Small chunks and inputs the cuts were not tuned for. The result and
+    // the error position must still be the sequential ones.
+    auto small = randomProgram(g, 4096);
+    std::vector<std::pair<const char *, std::vector<SymbolID>>> cases{
+        {"4k", small},
+        {"4k, 1 mutation", mutate(small, 1, 1)},
+        {"4k, 1% mutated", mutate(small, small.size() / 100, 2)},
+        {"4k, nested if", nestedProgram(g, 1024)},
+        {"full, 10 mutations", mutate(tokens, 10, 3)},
+    };
+    SpeculativeParser::Options options;
+    options.threads = 16;
+    options.minChunk = 16;
+    printf("\nAdversarial inputs, %zu threads, chunks of at least %zu tokens\n",
+           options.threads, options.minChunk);
+    printf("%-20s %10s %10s %10s %7s %12s %8s\n", "input", "tokens",
+           "seq ms", "spec ms", "chunks", "sequential", "same");
+    for (auto const &[name, input] : cases) {
+        util::Span<SymbolID const> span(input);
+        bool expected = false, ok = false;
+        double seqTime =
+            timeMilli([&] { expected = speculative.parseSequential(span); });
+        auto errorPosition = speculative.getErrorPosition();
+        double t = timeMilli([&] { ok = speculative.parse(span, options); });
+        bool same =
+            ok == expected && speculative.getErrorPosition() == errorPosition;
+        printf("%-20s %10zu %10.2f %10.2f %7zu %12zu %8s\n", name,
+               input.size(), seqTime, t, speculative.getChunks(),
+               speculative.getSequentialTokens(), same ? "yes" : "NO");
+    }
+    return 0;
+}
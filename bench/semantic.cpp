@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "src/parser/LALRParser.h"
+#include "src/parser/ParseSession.h"
+#include "src/parser/SemanticStack.h"
+
+using namespace gram;
+
+namespace {
+
+// Parses `tokens` once and counts the calls to operator new.
+size_t countAllocations(ParseSession &session,
+                        std::vector<SymbolID> const &tokens) {
+    bench::HeapStats::start();
+    session.reset();
+    session.feed(util::Span<SymbolID const>(tokens));
+    bench::HeapStats::stop();
+    return bench::HeapStats::allocations();
+}
+
+} // namespace
+
+// Arguments: [million tokens (default: 2)]
+int bench::semantic(int argc, char **argv) {
+    double millions = argc > 0 ? std::atof(argv[0]) : 2;
+    if (millions <= 0) {
+        fprintf(stderr, "Illegal arguments\n");
+        return 1;
+    }
+
+    auto g = grammarFromString(programRules);
+    auto lr = buildParser<LALRParser>(g);
+    auto tokens = randomProgram(g, static_cast<size_t>(millions * 1e6));
+    auto shifts = tokens.size() - 1;
+
+    // Each value is the number of nodes in its subtree, so the result is
+    // the number of shifts plus the number of reductions.
+    SemanticStack<long> stack(g);
+    stack.setShiftAction([](SymbolID) { return 1L; });
+    for (size_t i = 0; i < g.getOriginalProductions().size(); ++i) {
+        stack.setReduceAction(static_cast<ProductionID>(i),
+                              [](util::Span<long> children) {
+                                  long nodes = 1;
+                                  for (long n : children)
+                                      nodes += n;
+                                  return nodes;
+                              });
+    }
+    ParseSession plain(*lr);
+    ParseSession session(*lr, &stack);
+
+    // The first parse grows the stacks to the maximum depth.
+    size_t coldAllocations = countAllocations(session, tokens);
+    bool ok = session.getStatus() == ParseSession::ACCEPTED;
+    auto reductions = static_cast<size_t>(stack.takeResult()) - shifts;
+    size_t warmAllocations = countAllocations(session, tokens);
+
+    double plainTime = timeMilli([&] {
+        plain.reset();
+        plain.feed(util::Span<SymbolID const>(tokens));
+    });
+    double stackTime = timeMilli([&] {
+        session.reset();
+        session.feed(util::Span<SymbolID const>(tokens));
+    });
+
+    printf("Tokens: %zu, reductions: %zu, accepted=%d\n\n", tokens.size(),
+           reductions, ok);
+    printf("%-28s %10s %10s\n", "driver", "ms", "ns/token");
+    printf("%-28s %10.2f %10.2f\n", "ParseSession", plainTime,
+           plainTime * 1e6 / static_cast<double>(tokens.size()));
+    printf("%-28s %10.2f %10.2f\n", "ParseSession + SemanticStack",
+           stackTime, stackTime * 1e6 / static_cast<double>(tokens.size()));
+
+    printf("\n%-28s %12s %16s\n", "parse", "allocations",
+           "per reduction");
+    printf("%-28s %12zu %16.6f\n", "first", coldAllocations,
+           static_cast<double>(coldAllocations) /
+               static_cast<double>(reductions));
+    printf("%-28s %12zu %16.6f\n", "steady state", warmAllocations,
+           static_cast<double>(warmAllocations) /
+               static_cast<double>(reductions));
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "src/parser/LR1Parser.h"
+#include "src/util/BitSet.h"
+#include "src/util/HashSet.h"
+#include "src/util/HashedBitSet.h"
+#include "src/util/HybridSet.h"
+#include "src/util/TreeSet.h"
+
+using namespace gram;
+
+namespace {
+
+struct Corpus {
+    const char *name;
+    std::string rules;
+};
+
+std::vector<Corpus> corpus() {
+    return {
+        {"expr", "exp -> exp + term | term\n"
+                 "term -> term * fac | fac\n"
+                 "fac -> ID | ( exp )\n"},
+        {"lr1", "S -> a A d | b B d | a B e | b A e\n"
+                "A -> c\n"
+                "B -> c\n"},
+        {"nullable", "S -> A B | C D\n"
+                     "A -> a A | epsilon\n"
+                     "B -> b B | A\n"
+                     "C -> D c | epsilon\n"
+                     "D -> C d | epsilon\n"},
+        {"prec-10", bench::precedenceGrammar(10)},
+        {"prec-40", bench::precedenceGrammar(40)},
+    };
+}
+
+// A DFA in a form which doesn't depend on the set type: the sorted NFA
+// states of each closure, and the transitions of each state in the order
+// they were found.
+struct Subsets {
+    std::vector<std::vector<StateID>> closures;
+    std::vector<std::vector<Transition>> transitions;
+
+    bool operator==(Subsets const &other) const {
+        auto sameTransitions = [](std::vector<Transition> const &a,
+                                  std::vector<Transition> const &b) {
+            return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                              [](Transition const &x, Transition const &y) {
+                                  return x.action == y.action &&
+                                         x.destination == y.destination;
+                              });
+        };
+        return closures == other.closures &&
+               std::equal(transitions.begin(), transitions.end(),
+                          other.transitions.begin(), other.transitions.end(),
+                          sameTransitions);
+    }
+};
+
+template <class Set> std::vector<StateID> sorted(Set const &set) {
+    std::vector<StateID> res;
+    set.forEach([&res](StateID s) { res.push_back(s); });
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+// The DFA built by the parser, with its configured Closure type.
+Subsets reference(PushDownAutomaton const &dfa) {
+    Subsets res;
+    for (auto const &closure : dfa.getClosures()) {
+        auto id = static_cast<StateID>(res.closures.size());
+        res.closures.push_back(sorted(closure));
+        auto trans = dfa.transitionsOf(id);
+        res.transitions.emplace_back(trans.begin(), trans.end());
+    }
+    return res;
+}
+
+template <class Set> Subsets build(PushDownAutomaton const &nfa) {
+    std::vector<Set> closures;
+    std::vector<std::vector<Transition>> transitions;
+    nfa.buildSubsets(
+        closures, [](StateID) {},
+        [&transitions](StateID from, StateID to, ActionID action, bool) {
+            if (transitions.size() <= static_cast<size_t>(from))
+                transitions.resize(from + 1);
+            transitions[from].emplace_back(to, action);
+        });
+
+    Subsets res;
+    for (auto const &closure : closures)
+        res.closures.push_back(sorted(closure));
+    transitions.resize(closures.size());
+    res.transitions = std::move(transitions);
+    return res;
+}
+
+// Returns whether the result matches the reference.
+template <class Set>
+bool run(const char *setName, const char *grammarName,
+         PushDownAutomaton const &nfa, Subsets const &expected, int repeat) {
+    Subsets result;
+    bench::HeapStats::start();
+    double ms = bench::timeMilli([&] { result = build<Set>(nfa); }, repeat);
+    bench::HeapStats::stop();
+    bool ok = result == expected;
+    printf("%-10s %-12s %10.2f %12.1f %8zu  %s\n", grammarName, setName, ms,
+           bench::HeapStats::peak() / 1024.0, result.closures.size(),
+           ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+} // namespace
+
+// Arguments: [repeat (default: 3)]
+int bench::sets(int argc, char **argv) {
+    int repeat = argc > 0 ? std::atoi(argv[0]) : 3;
+    if (repeat <= 0) {
+        fprintf(stderr, "Illegal arguments\n");
+        return 1;
+    }
+
+    // Each set type runs the LR(1) subset construction of the parser. The
+    // results are compared with the DFA that the parser builds itself.
+    printf("%-10s %-12s %10s %12s %8s  %s\n", "grammar", "set", "time ms",
+           "peak KiB", "states", "result");
+    bool allOk = true;
+    for (auto const &entry : corpus()) {
+        auto g = grammarFromString(entry.rules);
+        LR1Parser parser(g);
+        parser.buildNFA();
+        parser.buildDFA();
+        auto const &nfa = parser.getNFA();
+        auto expected = reference(parser.getDFA());
+
+        auto name = entry.name;
+        allOk &= run<util::BitSet<StateID>>("BitSet", name, nfa, expected,
+                                            repeat);
+        allOk &= run<util::HashedBitSet<StateID>>("HashedBitSet", name, nfa,
+                                                  expected, repeat);
+        allOk &= run<util::HybridSet<StateID>>("HybridSet", name, nfa,
+                                               expected, repeat);
+        allOk &= run<util::TreeSet<StateID>>("TreeSet", name, nfa, expected,
+                                             repeat);
+        allOk &= run<util::HashSet<StateID>>("HashSet", name, nfa, expected,
+                                             repeat);
+    }
+    return allOk ? 0 : 1;
+}
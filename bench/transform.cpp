@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench/Bench.h"
+#include "src/parser/LALRParser.h"
+#include "src/parser/LR0Parser.h"
+#include "src/parser/LR1Parser.h"
+#include "src/parser/SLRParser.h"
+
+using namespace gram;
+
+namespace {
+
+struct Corpus {
+    std::string name;
+    std::string rules;
+};
+
+std::vector<Corpus> corpus() {
+    return {
+        {"stmt", "prog -> prog stmt | stmt\n"
+                 "stmt -> if ( exp ) stmt else stmt | if ( exp ) stmt ;\n"
+                 "stmt -> ID = exp ; | ID ( args ) ; | block\n"
+                 "block -> { prog }\n"
+                 "args -> args , exp | exp\n"
+                 "exp -> exp + term | term\n"
+                 "term -> ID | NUM | ( exp )\n"},
+        {"decl", "decls -> decls decl | decl\n"
+                 "decl -> type ID ; | type ID = init ; | type ID ( ) body\n"
+                 "type -> int | char | struct ID\n"
+                 "body -> { decls }\n"
+                 "init -> NUM | { NUM }\n"},
+        {"prec-10", bench::precedenceGrammar(10)},
+    };
+}
+
+Grammar load(std::string const &rules, bool transform) {
+    std::istringstream stream(rules);
+    auto g = GrammarReader::parse(stream);
+    if (transform)
+        g.transform(false);
+    return g.calAttributes();
+}
+
+template <class P>
+void run(const char *parserName, std::string const &grammarName,
+         Grammar const &original, Grammar const &transformed) {
+    P before(original), after(transformed);
+    before.buildNFA();
+    before.buildDFA();
+    after.buildNFA();
+    after.buildDFA();
+    auto nfaBefore = before.getNFA().getAllStates().size();
+    auto nfaAfter = after.getNFA().getAllStates().size();
+    auto dfaBefore = before.getDFA().getClosures().size();
+    auto dfaAfter = after.getDFA().getClosures().size();
+    printf("%-10s %-6s %8zu %8zu %8zu %8zu %+8ld\n", grammarName.c_str(),
+           parserName, nfaBefore, nfaAfter, dfaBefore, dfaAfter,
+           static_cast<long>(dfaBefore) - static_cast<long>(dfaAfter));
+}
+
+} // namespace
+
+// Arguments: [grammar files...]
+int bench::transform(int argc, char **argv) {
+    auto grammars = corpus();
+    for (int i = 0; i < argc; ++i) {
+        std::ifstream file(argv[i]);
+        if (!file) {
+            fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+        std::stringstream rules;
+        rules << file.rdbuf();
+        grammars.push_back({argv[i], rules.str()});
+    }
+
+    // The states which Grammar::transform() saves for each type of parser.
+    // Like --transform for LR tables, it only inlines: left-factoring is for
+    // LL(1) tables, and adds LR states for the helper symbols.
+    printf("%-10s %-6s %8s %8s %8s %8s %8s\n", "grammar", "parser", "NFA",
+           "NFA'", "DFA", "DFA'", "saved");
+    for (auto const &entry : grammars) {
+        auto original = load(entry.rules, false);
+        auto transformed = load(entry.rules, true);
+        run<LR0Parser>("lr0", entry.name, original, transformed);
+        run<SLRParser>("slr", entry.name, original, transformed);
+        run<LALRParser>("lalr", entry.name, original, transformed);
+        run<LR1Parser>("lr1", entry.name, original, transformed);
+    }
+    return 0;
+}
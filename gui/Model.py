@@ -9,6 +9,7 @@ from PyQt5.QtCore import Qt
 from PyQt5.QtSvg import QSvgWidget
 from collections import deque
 from GuiConfig import *
+from StepTrace import readSteps
 import sys
 import subprocess
 import os
@@ -358,7 +359,11 @@ def getLRSteps(opts: LRParserOptions,
         'LR(1)': 'lr1'
     }[opts.parser]
 
-    cmd = [opts.bin, '-t', parser, '-o', opts.out, '-g', opts.grammar]
+    # The binary trace is smaller and faster to write for large grammars.
+    cmd = [
+        opts.bin, '-t', parser, '--binary-steps', '-o', opts.out, '-g',
+        opts.grammar
+    ]
 
     if isspace(test):
         test = '$'
@@ -380,9 +385,10 @@ def getLRSteps(opts: LRParserOptions,
 
     # print('Output written to temporary directory', opts.outDir, sep=' ')
 
-    with open(os.path.join(opts.out, 'steps.py'), mode='r',
-              encoding='utf-8') as f:
-        steps = f.read().strip().split(sep='\n')
+    try:
+        steps = readSteps(os.path.join(opts.out, 'steps.bin'))
+    except (OSError, ValueError, IndexError) as e:
+        return ([], 'Cannot read the step trace: {}'.format(e))
 
     return (steps, None)
 
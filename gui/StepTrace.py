@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+# Converts a binary step trace (steps.bin, written with --binary-steps) to the
+# Python statements of steps.py. The format is described in
+# src/display/steps.cpp.
+#
+# Usage: StepTrace.py steps.bin [steps.py]
+# The output is written to stdout if no file is given.
+
+import sys
+from typing import Callable, Dict, List, Tuple
+
+MAGIC = b'LRSTEPS1'
+
+# Opcodes, as in src/display/steps.cpp.
+(SYMBOL, PRODUCTION, NULLABLE, ADD_FIRST, MERGE_FIRST, ADD_FOLLOW,
+ MERGE_FOLLOW, MERGE_FOLLOW_FROM_FIRST, ADD_TABLE_ENTRY, REMOVE_TABLE_ENTRY,
+ TEXT, ADD_STATE, UPDATE_STATE, ADD_EDGE, SET_START, SET_FINAL, AST_ADD_NODE,
+ AST_SET_PARENT, SHOW, SECTION) = range(1, 21)
+
+BOOL_STR = (b'False', b'True')
+
+
+# Same as escape_ascii() in src/common.h.
+def escape(s: bytes) -> bytes:
+    return (s.replace(b'\\', b'\\\\').replace(b'"', b'\\"')
+            .replace(b'\t', b'\\t').replace(b'\r', b'\\r')
+            .replace(b'\n', b'\\n'))
+
+
+class Reader:
+    def __init__(self, data: bytes):
+        self.data = data
+        self.pos = 0
+
+    def varint(self) -> int:
+        value = 0
+        shift = 0
+        while True:
+            byte = self.data[self.pos]
+            self.pos += 1
+            value |= (byte & 0x7f) << shift
+            if byte < 0x80:
+                return value
+            shift += 7
+
+    def int(self) -> bytes:
+        value = self.varint()
+        return b'%d' % ((value >> 1) ^ -(value & 1))
+
+    def byte(self) -> int:
+        self.pos += 1
+        return self.data[self.pos - 1]
+
+    def string(self) -> bytes:
+        size = self.varint()
+        self.pos += size
+        return self.data[self.pos - size:self.pos]
+
+
+def symbol(r: Reader) -> bytes:
+    id, name, flags = r.int(), r.string(), r.byte()
+    return (b'symbol[%s].name="%s"\n' % (id, escape(name)) +
+            b'symbol[%s].is_term=%s\n' % (id, BOOL_STR[flags & 1]) +
+            b'symbol[%s].is_start=%s\n' % (id, BOOL_STR[flags >> 1 & 1]))
+
+
+def production(r: Reader) -> bytes:
+    id, head = r.int(), r.int()
+    body = [r.int() for _ in range(r.varint())]
+    return (b'production[%s].head = %s\n' % (id, head) +
+            b'production[%s].body = [%s]\n' % (id, b', '.join(body)) +
+            b'symbol[%s].productions.append(%s)\n' % (head, id))
+
+
+def nullable(r: Reader) -> bytes:
+    symbol = r.int()
+    return b'symbol[%s].nullable = %-5s\n' % (symbol, BOOL_STR[r.byte()])
+
+
+def mergeFollowFromFirst(r: Reader) -> bytes:
+    dest, src, eps = r.int(), r.int(), r.int()
+    return (b'symbol[%s].follow.update(symbol[%s].first)\n' % (dest, src) +
+            b'symbol[%s].follow.discard(%s)\n' % (dest, eps))
+
+
+def tableEntry(fmt: bytes) -> Callable[[Reader], bytes]:
+    return lambda r: fmt % (r.int(), r.int(), r.string())
+
+
+# The fields are integers, and a string at the end if `escaped` is set.
+def record(fmt: bytes, ints: int, escaped: bool) -> Callable[[Reader], bytes]:
+    def convert(r: Reader) -> bytes:
+        args: Tuple[bytes, ...] = tuple(r.int() for _ in range(ints))
+        if escaped:
+            args += (escape(r.string()),)
+        return fmt % args
+    return convert
+
+
+CONVERTERS: Dict[int, Callable[[Reader], bytes]] = {
+    SYMBOL: symbol,
+    PRODUCTION: production,
+    NULLABLE: nullable,
+    ADD_FIRST: record(b'symbol[%s].first.add(%s)\n', 2, False),
+    MERGE_FIRST: record(b'symbol[%s].first.update(symbol[%s].first)\n', 2,
+                        False),
+    ADD_FOLLOW: record(b'symbol[%s].follow.add(%s)\n', 2, False),
+    MERGE_FOLLOW: record(b'symbol[%s].follow.update(symbol[%s].follow)\n', 2,
+                         False),
+    MERGE_FOLLOW_FROM_FIRST: mergeFollowFromFirst,
+    ADD_TABLE_ENTRY: tableEntry(b"table[%s][%s].add('%s')\n"),
+    REMOVE_TABLE_ENTRY: tableEntry(b"table[%s][%s].discard('%s')\n"),
+    TEXT: lambda r: r.string(),
+    ADD_STATE: record(b'addState(%s, "%s")\n', 1, True),
+    UPDATE_STATE: record(b'updateState(%s, "%s")\n', 1, True),
+    ADD_EDGE: record(b'addEdge(%s, %s, "%s")\n', 2, True),
+    SET_START: record(b'setStart(%s)\n', 1, False),
+    SET_FINAL: record(b'setFinal(%s)\n', 1, False),
+    AST_ADD_NODE: record(b'astAddNode(%s, "%s")\n', 1, True),
+    AST_SET_PARENT: record(b'astSetParent(%s, %s)\n', 2, False),
+    SHOW: record(b'show("%s")\n', 0, True),
+    SECTION: record(b'section("%s")\n', 0, True),
+}
+
+
+# Returns the contents of steps.py for the binary trace `data`.
+def convert(data: bytes) -> bytes:
+    if not data.startswith(MAGIC):
+        raise ValueError('Not a binary step trace')
+    r = Reader(data)
+    r.pos = len(MAGIC)
+    out: List[bytes] = []
+    while r.pos < len(data):
+        op = r.byte()
+        if op not in CONVERTERS:
+            raise ValueError('Unknown record {} at offset {}'.format(
+                op, r.pos - 1))
+        out.append(CONVERTERS[op](r))
+    return b''.join(out)
+
+
+# Reads steps.bin and returns the lines of steps.py. The GUI loads its steps
+# with it.
+def readSteps(path: str) -> List[str]:
+    with open(path, mode='rb') as f:
+        text = convert(f.read()).decode('utf-8')
+    return text.strip().split(sep='\n')
+
+
+if __name__ == '__main__':
+    if len(sys.argv) not in (2, 3):
+        print('Usage: {} steps.bin [steps.py]'.format(sys.argv[0]),
+              file=sys.stderr)
+        sys.exit(1)
+    with open(sys.argv[1], mode='rb') as f:
+        result = convert(f.read())
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], mode='wb') as f:
+            f.write(result)
+    else:
+        sys.stdout.buffer.write(result)
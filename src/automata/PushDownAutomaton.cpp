@@ -2,11 +2,7 @@
 
 #include <cassert>
 #include <cstdio>
-#include <optional>
-#include <stack>
-#include <queue>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <algorithm>
 
@@ -32,10 +28,44 @@ StateID PushDownAutomaton::addPseudoState() {
 
 void PushDownAutomaton::addTransition(StateID from, StateID to,
                                       ActionID action) {
+    assert(!frozenFlag);
     auto &trans = *states[from].transitions;
     trans.insert(Transition{to, action});
 }
 
+void PushDownAutomaton::freeze() {
+    edgeOffsets.assign(1, 0);
+    epsilonOffsets.assign(1, 0);
+    edges.clear();
+    epsilonEdges.clear();
+    edgeOffsets.reserve(states.size() + 1);
+    epsilonOffsets.reserve(states.size() + 1);
+    for (auto const &state : states) {
+        for (auto const &tran : *state.transitions) {
+            if (isEpsilonAction(tran.action))
+                epsilonEdges.push_back(tran.destination);
+            else
+                edges.push_back(tran);
+        }
+        edgeOffsets.push_back(static_cast<int>(edges.size()));
+        epsilonOffsets.push_back(static_cast<int>(epsilonEdges.size()));
+    }
+    frozenFlag = true;
+}
+
+util::Span<Transition const>
+PushDownAutomaton::transitionsOf(StateID state, ActionID action) const {
+    assert(!isEpsilonAction(action));
+    auto all = transitionsOf(state);
+    auto first = std::lower_bound(
+        all.begin(), all.end(), action,
+        [](Transition const &t, ActionID a) { return t.action < a; });
+    auto last = first;
+    while (last != all.end() && last->action == action)
+        ++last;
+    return {first, static_cast<size_t>(last - first)};
+}
+
 void PushDownAutomaton::addEpsilonTransition(StateID from, StateID to) {
     assert(epsilonAction >= 0);
     return addTransition(from, to, epsilonAction);
@@ -48,7 +78,7 @@ void PushDownAutomaton::highlightState(StateID state) const {
 void PushDownAutomaton::setDumpFlag(bool flag) { includeConstraints = flag; }
 
 void PushDownAutomaton::markStartState(StateID state) {
-    startState = state;
+    startStates.push_back(state);
     highlightState(state);
 }
 
@@ -130,7 +160,8 @@ void PushDownAutomaton::dump(FILE *stream) const {
         }
 
         fprintf(stream, "];\n");
-        if (stateID == getStartState()) {
+        if (std::find(startStates.begin(), startStates.end(), stateID) !=
+            startStates.end()) {
             fprintf(stream, "  start -> %d;\n", stateID);
         }
         for (auto &tran : *state.transitions) {
@@ -147,64 +178,6 @@ void PushDownAutomaton::dump(FILE *stream) const {
     fprintf(stream, "}");
 }
 
-// This function calculate closure and store information in place;
-// Must be used inside toDFA(), because only then transitions are sorted.
-void PushDownAutomaton::makeClosure(Closure &closure) const {
-    std::stack<StateID> stack;
-    for (auto s : closure)
-        stack.push(static_cast<StateID>(s));
-
-    while (!stack.empty()) {
-        auto s = stack.top();
-        stack.pop();
-        auto const &trans = *states[s].transitions;
-        auto range = trans.rangeOf(epsilonAction);
-        for (auto it = range.first; it != range.second; ++it) {
-            // Can reach this state by epsilon
-            if (!closure.contains(it->destination)) {
-                closure.insert(it->destination);
-                stack.push(it->destination);
-            }
-        }
-    }
-}
-
-auto PushDownAutomaton::transit(
-    Closure const &closure, ActionID actionID,
-    std::vector<util::BitSet<StateID>> const &receiverVec) const
-    -> ::std::optional<Closure> {
-    assert(actionID != epsilonAction);
-
-    bool found = false;
-    Closure res{states.size()};
-
-    // Copy set
-    auto receivers = receiverVec[actionID];
-    
-    receivers &= closure;
-    // Use wrapper of std::set/std::unordered_set instead of BitSet.
-    // for (auto i : receivers) {
-    //     if (!closure.contains(i))
-    //         receivers.remove(i);
-    // }
-
-    for (auto state : receivers) {
-        // This state can receive current action
-        auto const &trans = *states[state].transitions;
-        auto range = trans.rangeOf(actionID);
-        for (auto it = range.first; it != range.second; ++it) {
-            res.insert(it->destination);
-            found = true;
-        }
-    }
-
-    if (!found)
-        return {};
-
-    makeClosure(res);
-    return std::make_optional<Closure>(std::move(res));
-}
-
 bool PushDownAutomaton::dumpState(FILE *stream, StateID stateID) const {
     using std::fprintf;
 
@@ -270,7 +243,7 @@ bool PushDownAutomaton::dumpClosure(FILE *stream, StateID closureID) const {
     bool dumpDetail = !launchArgs.noPDALabel;
     auto const &closure = closures[closureID];
     // This part calculates return value, so it cannot be skipped.
-    for (auto stateID : closure) {
+    closure.forEach([&](StateID stateID) {
         if (newLineFlag && dumpDetail)
             fprintf(stream, "\\n");
         auto const &auxState = auxStates[stateID];
@@ -291,15 +264,15 @@ bool PushDownAutomaton::dumpClosure(FILE *stream, StateID closureID) const {
         if (includeConstraints && dumpDetail) {
             fprintf(stream, ", ");
             bool slashFlag = false;
-            for (auto actionID : *constraint) {
+            constraint->forEach([&](ActionID actionID) {
                 if (slashFlag)
                     fprintf(stream, "/");
                 fputs_escape(stream, actions[actionID]);
                 slashFlag = true;
-            }
+            });
         }
         newLineFlag = true;
-    }
+    });
     return finalFlag;
 }
 
@@ -309,7 +282,7 @@ std::string PushDownAutomaton::dumpClosureString(StateID closureID) const {
     bool newLineFlag = false;
     auto const &closure = closures[closureID];
     // This part calculates return value, so it cannot be skipped.
-    for (auto stateID : closure) {
+    closure.forEach([&](StateID stateID) {
         if (newLineFlag)
             s += "\n";
         auto const &auxState = auxStates[stateID];
@@ -327,16 +300,16 @@ std::string PushDownAutomaton::dumpClosureString(StateID closureID) const {
         if (this->includeConstraints) {
             s += ", ";
             bool slash = false;
-            for (auto actionID : *constraint) {
+            constraint->forEach([&](ActionID actionID) {
                 if (slash)
                     s += "/";
                 s += escape_ascii(actions[actionID]);
                 slash = true;
-            }
+            });
         }
 
         newLineFlag = true;
-    }
+    });
     return s;
 }
 
@@ -357,86 +330,41 @@ PushDownAutomaton PushDownAutomaton::toDFA() {
     dfa.setEndOfInputAction(this->endOfInputAction);
     dfa.setEpsilonAction(this->epsilonAction);
 
-    // The result is used by transit()
-    std::vector<util::BitSet<StateID>> receiverVec(actions.size());
+    if (!frozenFlag)
+        freeze();
 
-    for (StateID stateID{0}, stateIDLimit = static_cast<StateID>(states.size());
-         stateID < stateIDLimit; stateID = StateID{stateID + 1}) {
-        for (auto &tran : *states[stateID].transitions)
-            receiverVec[tran.action].insert(stateID);
-    }
-
-    // States that need to be processed.
-    // We need to ensure that for S in `stack`, makeClosure(S) == S.
-    // std::stack<StateID> stack;
-    std::queue<StateID> queue;
-    std::unordered_map<Closure, StateID> closureIDMap;
-    // std::vector<Closure> closureVec;
-
-    auto addNewState = [&closureIDMap, &dfa, &queue](Closure &&c) {
-        auto stateIndex = static_cast<StateID>(dfa.closures.size());
-        dfa.closures.push_back(std::move(c));
-        closureIDMap.emplace(dfa.closures.back(), stateIndex);
-        // Cannot decide label now. Constraints are of no use to minial DFA.
-        dfa.addPseudoState();
-        // stack.push(stateIndex);
-        queue.push(stateIndex);
-        return stateIndex;
-    };
-
-    // Add start state
-    Closure start{states.size()};
-    start.insert(startState);
-    makeClosure(start);
-    auto stateIndex = addNewState(std::move(start));
-    dfa.markStartState(stateIndex);
-
-    step::addState(stateIndex, dfa.dumpStateString(stateIndex));
-    step::setStart(stateIndex);
-    step::show("Add start state.");
     util::Formatter f;
-
-    while (!queue.empty()) {
-        auto stateID = queue.front();
-        queue.pop();
-
-        for (size_t i = 0; i < actions.size(); ++i) {
-            auto actionID = static_cast<ActionID>(i);
-
-            if (actionID == epsilonAction)
-                continue;
-
-            // If this action is not acceptable, the entire test will
-            // be skipped.
-            auto result = transit(dfa.closures[stateID], actionID, receiverVec);
-            if (result.has_value()) {
-                auto &value = result.value();
-                auto existingIter = closureIDMap.find(value);
-
-                if (existingIter == closureIDMap.end()) {
-                    // Because LALR may combine constraints
-                    auto nextStateID = addNewState(std::move(value));
-
-                    step::addState(nextStateID, dfa.dumpStateString(nextStateID));
-                    step::addEdge(stateID, nextStateID, actions[actionID]);
-                    auto sv = f.formatView("Trans(s%d, %s) = s%d", stateID, actions[actionID], nextStateID);
-                    step::show(sv);
-
-                    // Add edge to this new state
-                    dfa.addTransition(stateID, nextStateID, actionID);
-                } else {
-                    // Add edge to this previous state
-                    dfa.addTransition(stateID, existingIter->second, actionID);
-
-                    step::addEdge(stateID, existingIter->second, actions[actionID]);
-                    auto sv = f.formatView("Trans(s%d, %s) = s%d", stateID, actions[actionID], existingIter->second);
-                    step::show(sv);
-                }
-            }
-        }
-    }
+    buildSubsets(
+        dfa.closures,
+        [&](StateID state) {
+            // Cannot decide label now. Constraints are of no use to minial
+            // DFA.
+            dfa.addPseudoState();
+            dfa.markStartState(state);
+
+            if (!step::enabled())
+                return;
+            step::addState(state, dfa.dumpStateString(state));
+            step::setStart(state);
+            step::show("Add start state.");
+        },
+        [&](StateID from, StateID to, ActionID actionID, bool isNew) {
+            if (isNew)
+                dfa.addPseudoState();
+            dfa.addTransition(from, to, actionID);
+
+            if (!step::enabled())
+                return;
+            if (isNew)
+                step::addState(to, dfa.dumpStateString(to));
+            step::addEdge(from, to, actions[actionID]);
+            auto sv = f.formatView("Trans(s%d, %s) = s%d", from,
+                                   actions[actionID], to);
+            step::show(sv);
+        });
 
     // TODO: set final
+    dfa.freeze();
     return dfa;
 }
 
@@ -1,11 +1,15 @@
 #ifndef LRPARSER_AUTOMATA_H
 #define LRPARSER_AUTOMATA_H
 
+#include <algorithm>
+#include <cassert>
 #include <functional>
 #include <map>
 #include <memory>
 #include <optional>
+#include <queue>
 #include <set>
+#include <stack>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -13,10 +17,14 @@
 #include <vector>
 
 #include "src/common.h"
+#include "src/util/Arena.h"
 #include "src/util/BitSet.h"
 #include "src/util/ResourceProvider.h"
+#include "src/util/Span.h"
 #include "src/util/TreeSet.h"
 #include "src/util/HashSet.h"
+#include "src/util/HashedBitSet.h"
+#include "src/util/HybridSet.h"
 
 namespace gram {
 class Grammar;
@@ -27,28 +35,35 @@ struct Transition {
     Transition(StateID to, ActionID action) : action(action), destination(to) {}
 };
 
+// Transitions of a state under construction, sorted by action. Transitions
+// with the same action keep their insertion order. A state has few
+// transitions, so a sorted vector is smaller and faster than a tree. Its
+// storage comes from an arena owned by the parser.
 struct TransitionSet {
-    // Returns a flag indicating whether the insertion makes the automaton a
-    // NFA.
-    auto insert(const Transition &key) {
-        auto it = set.find(key);
-        if (it == set.end() || it->destination != key.destination)
-            return set.insert(key);
-        return it;
+    [[nodiscard]] auto rangeOf(ActionID actionID) const {
+        return std::equal_range(set.begin(), set.end(),
+                                Transition{StateID{-1}, actionID},
+                                TransitionComparator{});
+    }
+    // Returns a flag indicating whether the transition is new.
+    bool insert(const Transition &key) {
+        auto range = rangeOf(key.action);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->destination == key.destination)
+                return false;
+        }
+        set.insert(range.second, key);
+        return true;
     }
     [[nodiscard]] auto size() const noexcept { return set.size(); }
-    [[nodiscard]] auto begin() { return set.begin(); }
-    [[nodiscard]] auto end() { return set.end(); }
     [[nodiscard]] auto begin() const { return set.begin(); }
     [[nodiscard]] auto end() const { return set.end(); }
-    [[nodiscard]] auto rangeOf(ActionID actionID) const {
-        return set.equal_range(Transition{StateID{-1}, actionID});
-    }
     [[nodiscard]] bool contains(ActionID action) const {
         auto range = rangeOf(action);
         return range.first != range.second;
     }
-    TransitionSet() = default;
+    explicit TransitionSet(util::Arena &arena)
+        : set(util::ArenaAllocator<Transition>(arena)) {}
 
   private:
     struct TransitionComparator {
@@ -56,15 +71,24 @@ struct TransitionSet {
             return a.action < b.action;
         }
     };
-    std::multiset<Transition, TransitionComparator> set;
+    std::vector<Transition, util::ArenaAllocator<Transition>> set;
 };
 
-using Constraint = util::BitSet<ActionID>;
+// Constraints are keys of the seed map of LR(1) and the constraint pool of
+// LALR(1), so they keep their hashes.
+using Constraint = util::HashedBitSet<ActionID>;
 
-// TreeSet: ~2   seconds
-// BitSet:  ~1.4 seconds
-// HashSet: Result is incorrect.
+// `lrparser_bench sets` compares BitSet, HashedBitSet, HybridSet, TreeSet and
+// HashSet as closures. BitSet is the fastest. HybridSet keeps closures of
+// large NFAs small, and HashedBitSet makes the lookups in toDFA() cheaper.
+// Select them with the CMake option LRPARSER_CLOSURE_SET=hybrid or hashed.
+#if defined(LRPARSER_HYBRID_CLOSURE)
+using Closure = util::HybridSet<StateID>;
+#elif defined(LRPARSER_HASHED_CLOSURE)
+using Closure = util::HashedBitSet<StateID>;
+#else
 using Closure = util::BitSet<StateID>;
+#endif
 
 // For transformed DFA, state is a pseudo state, only containing transition
 // information.
@@ -116,6 +140,7 @@ class PushDownAutomaton {
     ActionID addAction(const char *s);
     void addTransition(StateID from, StateID to, ActionID action);
     void addEpsilonTransition(StateID from, StateID to);
+    // Adds a start state. The first one is the default.
     void markStartState(StateID state);
     void highlightState(StateID state) const;
     void setDumpFlag(bool flag);
@@ -124,7 +149,10 @@ class PushDownAutomaton {
 
     // Accessors
     [[nodiscard]] auto const &getAllStates() const { return states; }
-    [[nodiscard]] StateID getStartState() const { return startState; }
+    [[nodiscard]] StateID getStartState() const {
+        return startStates.empty() ? StateID{-1} : startStates.front();
+    }
+    [[nodiscard]] auto const &getStartStates() const { return startStates; }
     [[nodiscard]] auto const &getAllActions() const { return actions; }
     [[nodiscard]] auto const &getClosures() const {
         assert(transformedDFAFlag);
@@ -139,12 +167,48 @@ class PushDownAutomaton {
     }
     [[nodiscard]] bool isDFA() const { return !indefiniteFlag; }
 
+    // Copies all transitions into a compressed sparse row layout, which
+    // the following accessors read. Call it when no more transitions will be
+    // added.
+    void freeze();
+    [[nodiscard]] bool isFrozen() const { return frozenFlag; }
+    // Non-epsilon transitions of a state, sorted by action.
+    [[nodiscard]] util::Span<Transition const>
+    transitionsOf(StateID state) const {
+        assert(frozenFlag);
+        return {edges.data() + edgeOffsets[state],
+                static_cast<size_t>(edgeOffsets[state + 1] -
+                                    edgeOffsets[state])};
+    }
+    // Transitions of a state with the given non-epsilon action.
+    [[nodiscard]] util::Span<Transition const>
+    transitionsOf(StateID state, ActionID action) const;
+    [[nodiscard]] util::Span<StateID const>
+    epsilonTransitionsOf(StateID state) const {
+        assert(frozenFlag);
+        return {epsilonEdges.data() + epsilonOffsets[state],
+                static_cast<size_t>(epsilonOffsets[state + 1] -
+                                    epsilonOffsets[state])};
+    }
+
     // DFA generation
-    void makeClosure(Closure &closure) const;
+    // The automaton must be frozen. Closures can be any set type with
+    // insert(), contains(), forEachIntersection(), == and std::hash, so that
+    // set implementations can be compared (see bench/sets.cpp).
+    template <class Set> void makeClosure(Set &closure) const;
 
-    [[nodiscard]] std::optional<Closure>
-    transit(Closure const &closure, ActionID action,
-            std::vector<util::BitSet<StateID>> const &receiverVec) const;
+    template <class Set>
+    [[nodiscard]] std::optional<Set>
+    transit(Set const &closure, ActionID action,
+            std::vector<Set> const &receiverVec) const;
+
+    // Subset construction. The closure of each new DFA state is appended to
+    // `closures`. onStart(state) is called for each start state, and
+    // onTransition(from, to, action, isNew) for each transition, where
+    // `isNew` tells whether `to` has just been added.
+    template <class Set, class OnStart, class OnTransition>
+    void buildSubsets(std::vector<Set> &closures, OnStart &&onStart,
+                      OnTransition &&onTransition) const;
 
     // Returns a new DFA which is transformed from this automaton.
     // Since the DFA is new, there is no need to call separateKernels().
@@ -196,13 +260,21 @@ class PushDownAutomaton {
     // To differentiate normal DFAs and transformed DFAs
     bool transformedDFAFlag = false;
     bool includeConstraints = false;
-    StateID startState{-1};
+    // Set by freeze(). Transitions must not be added afterwards.
+    bool frozenFlag = false;
+    std::vector<StateID> startStates;
     ActionID epsilonAction{-1};
     ActionID endOfInputAction{-1};
     util::ResourceProvider<TransitionSet> *transitionSetProvider;
     std::vector<std::vector<const char *>> const *kernelLabelMap;
     std::vector<State> states;
     std::vector<const char *> actions;
+    // Transitions of state i are edges[edgeOffsets[i], edgeOffsets[i + 1]),
+    // and the same goes for epsilon transitions. Built by freeze().
+    std::vector<int> edgeOffsets;
+    std::vector<Transition> edges;
+    std::vector<int> epsilonOffsets;
+    std::vector<StateID> epsilonEdges;
     // Contains highlight flags.
     mutable util::BitSet<StateID> highlightSet;
     // Not empty only when this automaton is a DFA transformed from
@@ -214,6 +286,111 @@ class PushDownAutomaton {
     // former NFA states.
     std::vector<State> auxStates;
 };
+
+// This function calculate closure and store information in place;
+template <class Set> void PushDownAutomaton::makeClosure(Set &closure) const {
+    std::stack<StateID> stack;
+    for (auto s : closure)
+        stack.push(static_cast<StateID>(s));
+
+    while (!stack.empty()) {
+        auto s = stack.top();
+        stack.pop();
+        for (auto dest : epsilonTransitionsOf(s)) {
+            // Can reach this state by epsilon
+            if (!closure.contains(dest)) {
+                closure.insert(dest);
+                stack.push(dest);
+            }
+        }
+    }
+}
+
+template <class Set>
+std::optional<Set>
+PushDownAutomaton::transit(Set const &closure, ActionID actionID,
+                           std::vector<Set> const &receiverVec) const {
+    assert(actionID != epsilonAction);
+
+    // Most actions cannot be accepted, so the result is only allocated when
+    // a state of the closure receives the action.
+    std::optional<Set> res;
+
+    closure.forEachIntersection(receiverVec[actionID], [&](StateID state) {
+        // This state can receive current action
+        for (auto const &tran : transitionsOf(state, actionID)) {
+            if (!res)
+                res.emplace(states.size());
+            res->insert(tran.destination);
+        }
+    });
+
+    if (res)
+        makeClosure(*res);
+    return res;
+}
+
+template <class Set, class OnStart, class OnTransition>
+void PushDownAutomaton::buildSubsets(std::vector<Set> &closures,
+                                     OnStart &&onStart,
+                                     OnTransition &&onTransition) const {
+    // The result is used by transit()
+    std::vector<Set> receiverVec(actions.size());
+
+    for (StateID stateID{0}, stateIDLimit = static_cast<StateID>(states.size());
+         stateID < stateIDLimit; stateID = StateID{stateID + 1}) {
+        for (auto &tran : transitionsOf(stateID))
+            receiverVec[tran.action].insert(stateID);
+    }
+
+    // States that need to be processed.
+    // We need to ensure that for S in `queue`, makeClosure(S) == S.
+    std::queue<StateID> queue;
+    std::unordered_map<Set, StateID> closureIDMap;
+
+    auto addNewState = [&closureIDMap, &closures, &queue](Set &&c) {
+        auto stateIndex = static_cast<StateID>(closures.size());
+        closures.push_back(std::move(c));
+        closureIDMap.emplace(closures.back(), stateIndex);
+        queue.push(stateIndex);
+        return stateIndex;
+    };
+
+    // Add start states. Their kernels are different augmented productions,
+    // so each one is a new state.
+    for (auto startState : startStates) {
+        Set start(states.size());
+        start.insert(startState);
+        makeClosure(start);
+        onStart(addNewState(std::move(start)));
+    }
+
+    while (!queue.empty()) {
+        auto stateID = queue.front();
+        queue.pop();
+
+        for (size_t i = 0; i < actions.size(); ++i) {
+            auto actionID = static_cast<ActionID>(i);
+
+            if (actionID == epsilonAction)
+                continue;
+
+            // If this action is not acceptable, the entire test will
+            // be skipped.
+            auto result = transit(closures[stateID], actionID, receiverVec);
+            if (!result.has_value())
+                continue;
+            auto existingIter = closureIDMap.find(*result);
+            if (existingIter == closureIDMap.end()) {
+                auto nextStateID = addNewState(std::move(*result));
+                onTransition(stateID, nextStateID, actionID, true);
+            } else {
+                onTransition(stateID, existingIter->second, actionID, false);
+            }
+        }
+    }
+}
+
 } // namespace gram
 
 #endif
\ No newline at end of file
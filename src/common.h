@@ -13,19 +13,23 @@ enum DisplayType {
     SYMBOL_TABLE,
     PARSE_TABLE,
     GRAMMAR_RULES,
-    PARSE_STATES
+    PARSE_STATES,
+    SYNTAX_TREE,
+    SHARED_FOREST,
+    LL_PARSE_TABLE
 };
 // INFO:    Provide important text information for users
 // VERBOSE: Users may want to have a look because it shows more details
 // DEBUG:   For debugging purposes.
 // ERR:     Error happened. Maybe it's caused by some illegal input.
-enum DisplayLogLevel { INFO = 0, ERR, VERBOSE, DEBUG, LOG_LEVELS_COUNT };
+// WARN:    The input is legal but likely a mistake, e.g. a useless rule.
+enum DisplayLogLevel { INFO = 0, ERR, WARN, VERBOSE, DEBUG, LOG_LEVELS_COUNT };
 enum SymbolType {
     NON_TERM = 0,
     TERM = 1, // For bool comparison
     UNCHECKED
 };
-enum ParserType { LR0, SLR, LALR, LR1 };
+enum ParserType { LR0, SLR, LALR, LR1, LL1 };
 enum ActionID : int;
 enum StateID : int;
 enum TransitionID : int;
@@ -63,11 +67,25 @@ struct LaunchArguments {
     bool noTest = false;
     // bool noPDA = false;
     bool noPDALabel = false;
+    bool dumpTree = false;
+    bool glr = false;
+    // Only print logs: no tables, parser states or automata.
+    bool quiet = false;
+    // Do not write the step trace for the GUI.
+    bool noSteps = false;
+    // Write the step trace in the binary format (steps.bin).
+    bool binarySteps = false;
+    // Remove useless symbols and productions from the grammar.
+    bool reduce = false;
+    // Inline and left-factor the grammar before building automata.
+    bool transform = false;
     ParserType parserType = SLR;
     DisplayLogLevel logLevel = VERBOSE;
     std::string grammarFileName = "grammar.txt";
     std::string resultsDir = ".";
     std::string sep = "->";
+    // Start symbol for the test input. Empty: the default one.
+    std::string entry;
 };
 
 extern LaunchArguments launchArgs;
@@ -77,6 +95,7 @@ struct Constants {
     constexpr static const char *dot = "\xE2\x80\xA2"; // \xE2\x80\xA2 is "•"; \xE2\x97\x8F is "●" in UTF-8
     constexpr static const char *epsilon = "\xCE\xB5"; // \xCE\xB5 is "ε" in UTF-8
     constexpr static const char *end_of_input = "$";
+    constexpr static const char *error_token = "error";
 };
 
 // 6. Format
@@ -11,6 +11,8 @@
 #include "src/automata/PushDownAutomaton.h"
 #include "src/common.h"
 #include "src/grammar/Grammar.h"
+#include "src/parser/GLRParser.h"
+#include "src/parser/LLParser.h"
 #include "src/parser/LRParser.h"
 #include "src/parser/SLRParser.h"
 #include "src/util/Formatter.h"
@@ -26,7 +28,6 @@ static std::array<const char *, LOG_LEVELS_COUNT> logs = {nullptr};
 // static int automatonCounter = 0;
 static std::chrono::steady_clock globalClock;
 static decltype(globalClock.now()) startUpTime;
-FILE *stepFile;
 
 double upTimeInMilli() {
     auto now = globalClock.now();
@@ -50,6 +51,7 @@ void lrInit() {
     logs[DisplayLogLevel::VERBOSE] = "VERBOSE";
     logs[DisplayLogLevel::DEBUG] = "DEBUG";
     logs[DisplayLogLevel::ERR] = "ERROR";
+    logs[DisplayLogLevel::WARN] = "WARNING";
 
     // util::Process::prevent_zombie();
 
@@ -57,16 +59,18 @@ void lrInit() {
     if (!fs::exists(outPath))
         fs::create_directories(outPath);
 
-    outPath /= "steps.py";
+    if (launchArgs.noSteps)
+        return;
+    outPath /= launchArgs.binarySteps ? "steps.bin" : "steps.py";
     std::string outName = outPath.string();
-    stepFile = std::fopen(outName.c_str(), "w");
+    step::open(outName.c_str(), launchArgs.binarySteps);
 }
 
 void lrCleanUp() {
     if (!launchArgs.launchSuccess) {
         return;
     }
-    std::fclose(stepFile);
+    step::close();
 }
 
 static void handleLog(const char *description, DisplayLogLevel level) {
@@ -265,6 +269,67 @@ static void handleSymbolTable(const char *description, DisplayLogLevel logLevel,
     printf("%s", outputString.c_str());
 }
 
+static void handleLLParseTable(const char *description,
+                               DisplayLogLevel logLevel,
+                               gram::LLParser const *ll) {
+    constexpr const int nameWidth = 8;
+    constexpr const int entryWidth = 6;
+
+    auto const &grammar = ll->getGrammar();
+    auto const &symbols = grammar.getAllSymbols();
+    auto epsilonID = grammar.getEpsilonSymbol().id;
+
+    util::Formatter f;
+    std::string outputString;
+    outputString += generateLogLine(description, logLevel);
+
+    // Rows are non-terminals and columns are terminals, including `$`.
+    std::vector<int> termVec;
+    termVec.reserve(symbols.size());
+    for (auto const &symbol : symbols) {
+        if (symbol.type == SymbolType::TERM && symbol.id != epsilonID)
+            termVec.push_back(symbol.id);
+    }
+
+    outputString += f.formatView("%*s ", nameWidth, "");
+    for (int terminal : termVec) {
+        outputString +=
+            f.formatView("|%*s ", entryWidth, symbols[terminal].name.c_str());
+    }
+    outputString += f.formatView("\n");
+
+    for (auto const &symbol : symbols) {
+        if (symbol.type != SymbolType::NON_TERM)
+            continue;
+        outputString += f.formatView("%*s ", nameWidth, symbol.name.c_str());
+        for (int terminal : termVec) {
+            std::string s =
+                ll->dumpParseTableEntry(symbol.id, ActionID{terminal});
+            outputString += f.formatView("|%*s ", entryWidth, s.c_str());
+        }
+        outputString += f.formatView("\n");
+    }
+
+    // No trailing '\n' is needed
+    printf("%s", outputString.c_str());
+}
+
+static void handleSyntaxTree(const char *description, DisplayLogLevel logLevel,
+                             gram::SyntaxTree const *tree,
+                             gram::Grammar const *grammar) {
+    std::string s = generateLogLine(description, logLevel);
+    s += tree->dumpString(*grammar);
+    printf("%s", s.c_str());
+}
+
+static void handleSharedForest(const char *description,
+                               DisplayLogLevel logLevel,
+                               gram::GLRParser const *glr) {
+    std::string s = generateLogLine(description, logLevel);
+    s += glr->getForest().dumpString(glr->getLRParser().getGrammar());
+    printf("%s", s.c_str());
+}
+
 static void handleGrammarRules(const char *description,
                                DisplayLogLevel logLevel,
                                gram::Grammar const *grammar) {
@@ -275,6 +340,11 @@ static void handleGrammarRules(const char *description,
 
 void display(DisplayType type, DisplayLogLevel level, const char *description,
              void const *pointer, void const *auxPointer) {
+    if (launchArgs.quiet &&
+        (type == AUTOMATON || type == PARSE_TABLE || type == PARSE_STATES || type == SYMBOL_TABLE ||
+         type == GRAMMAR_RULES || type == LL_PARSE_TABLE)) {
+        return;
+    }
     switch (type) {
     case DisplayType::AUTOMATON:
         handleAutomaton(description, level, (const char *)auxPointer,
@@ -295,6 +365,16 @@ void display(DisplayType type, DisplayLogLevel level, const char *description,
     case DisplayType::PARSE_STATES:
         handleParseStates(description, level, (LRParser const *)pointer);
         break;
+    case DisplayType::SYNTAX_TREE:
+        handleSyntaxTree(description, level, (SyntaxTree const *)pointer,
+                         (Grammar const *)auxPointer);
+        break;
+    case DisplayType::SHARED_FOREST:
+        handleSharedForest(description, level, (GLRParser const *)pointer);
+        break;
+    case DisplayType::LL_PARSE_TABLE:
+        handleLLParseTable(description, level, (LLParser const *)pointer);
+        break;
     default:
         fprintf(stderr, "[ERROR  ] Unknown display type. Check your code.\n");
         exit(1);
@@ -1,109 +1,359 @@
 #include "src/common.h"
 #include "src/display/steps.h"
+#include "src/util/AsyncWriter.h"
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string>
 
-
-extern FILE *stepFile;
+// Steps are written by util::AsyncWriter, either as the Python statements
+// read by the GUI, or as binary records which gui/StepTrace.py converts back.
+//
+// A binary trace starts with the 8 bytes "LRSTEPS1". Each record is an opcode
+// byte followed by its fields. Integers are zigzag varints, and strings are a
+// varint length followed by the raw bytes (they are escaped by the
+// converter).
+static std::unique_ptr<util::AsyncWriter> out;
+static bool binary = false;
 
 static const char *bool_str[2] = {"False", "True"};
 
+namespace {
+
+// Keep in sync with gui/StepTrace.py.
+enum Op : char {
+    SYMBOL = 1,      // id, name, flags (1: is_term, 2: is_start)
+    PRODUCTION,      // id, head, body size, body...
+    NULLABLE,        // symbol, nullable (one byte)
+    ADD_FIRST,       // symbol, component
+    MERGE_FIRST,     // dest, src
+    ADD_FOLLOW,      // symbol, component
+    MERGE_FOLLOW,    // dest, src
+    MERGE_FOLLOW_FROM_FIRST, // dest, src, eps
+    ADD_TABLE_ENTRY, // state, look ahead, action
+    REMOVE_TABLE_ENTRY, // state, look ahead, action
+    TEXT,            // text from step::printf(), written as is
+    ADD_STATE,       // state, description
+    UPDATE_STATE,    // state, description
+    ADD_EDGE,        // s1, s2, label
+    SET_START,       // state
+    SET_FINAL,       // state
+    AST_ADD_NODE,    // index, label
+    AST_SET_PARENT,  // child, parent
+    SHOW,            // message
+    SECTION,         // title
+};
+
+const char magic[] = "LRSTEPS1";
+
+// Like escape_ascii(), but without a temporary string.
+void putEscaped(std::string_view s) {
+    for (char c : s) {
+        switch (c) {
+        case '"':  out->write("\\\"", 2); break;
+        case '\\': out->write("\\\\", 2); break;
+        case '\t': out->write("\\t", 2); break;
+        case '\r': out->write("\\r", 2); break;
+        case '\n': out->write("\\n", 2); break;
+        default:   out->put(c);
+        }
+    }
+}
+
+} // namespace
+
 namespace step {
 
+bool open(const char *path, bool binaryTrace) {
+    close();
+    FILE *file = std::fopen(path, binaryTrace ? "wb" : "w");
+    if (!file)
+        return false;
+    out = std::make_unique<util::AsyncWriter>(file);
+    binary = binaryTrace;
+    if (binary)
+        out->write(magic, sizeof(magic) - 1);
+    return true;
+}
+
+bool close() {
+    if (!out)
+        return true;
+    bool ok = out->close();
+    out.reset();
+    return ok;
+}
+
+bool enabled() { return out != nullptr; }
+
 void symbol(int id, const char *name, bool is_term, bool is_start) {
-    std::string escaped_name = escape_ascii(name);
-    fprintf(stepFile, "symbol[%d].name=\"%s\"\n", id, escaped_name.c_str());
-    fprintf(stepFile, "symbol[%d].is_term=%s\n", id, bool_str[is_term]);
-    fprintf(stepFile, "symbol[%d].is_start=%s\n", id, bool_str[is_start]);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(SYMBOL);
+        out->putInt(id);
+        out->putString(name);
+        out->put(static_cast<char>(is_term | is_start << 1));
+        return;
+    }
+    out->printf("symbol[%d].name=\"", id);
+    putEscaped(name);
+    out->write("\"\n");
+    out->printf("symbol[%d].is_term=%s\n", id, bool_str[is_term]);
+    out->printf("symbol[%d].is_start=%s\n", id, bool_str[is_start]);
 }
 
 void production(int id, int head, const int *body, size_t body_size) {
-    fprintf(stepFile, "production[%d].head = %d\n", id, head);
-    fprintf(stepFile, "production[%d].body = [", id);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(PRODUCTION);
+        out->putInt(id);
+        out->putInt(head);
+        out->putVarint(body_size);
+        for (size_t index = 0; index < body_size; ++index)
+            out->putInt(body[index]);
+        return;
+    }
+    out->printf("production[%d].head = %d\n", id, head);
+    out->printf("production[%d].body = [", id);
     for (size_t index = 0; index < body_size; ++index) {
-        fprintf(stepFile, index ? ", %d" : "%d", body[index]);
+        out->printf(index ? ", %d" : "%d", body[index]);
     }
-    fprintf(stepFile, "]\n");
-    fprintf(stepFile, "symbol[%d].productions.append(%d)\n", head, id);
+    out->printf("]\n");
+    out->printf("symbol[%d].productions.append(%d)\n", head, id);
 }
 
 void nullable(int symbol, bool nullable, const char *explain) {
-    fprintf(stepFile, "symbol[%d].nullable = %-5s\n", symbol,
-            bool_str[nullable]);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(NULLABLE);
+        out->putInt(symbol);
+        out->put(nullable);
+    } else {
+        out->printf("symbol[%d].nullable = %-5s\n", symbol,
+                    bool_str[nullable]);
+    }
     show(explain);
 }
 
 void addFirst(int symbol, int component, const char *explain) {
-    fprintf(stepFile, "symbol[%d].first.add(%d)\n", symbol, component);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(ADD_FIRST);
+        out->putInt(symbol);
+        out->putInt(component);
+    } else {
+        out->printf("symbol[%d].first.add(%d)\n", symbol, component);
+    }
     show(explain);
 }
 
 void mergeFirst(int dest, int src, const char *explain) {
-    fprintf(stepFile, "symbol[%d].first.update(symbol[%d].first)\n", dest,
-            src);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(MERGE_FIRST);
+        out->putInt(dest);
+        out->putInt(src);
+    } else {
+        out->printf("symbol[%d].first.update(symbol[%d].first)\n", dest,
+                    src);
+    }
     show(explain);
 }
 
 void addFollow(int symbol, int component, const char *explain) {
-    fprintf(stepFile, "symbol[%d].follow.add(%d)\n", symbol, component);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(ADD_FOLLOW);
+        out->putInt(symbol);
+        out->putInt(component);
+    } else {
+        out->printf("symbol[%d].follow.add(%d)\n", symbol, component);
+    }
     show(explain);
 }
 
 void mergeFollow(int dest, int src, const char *explain) {
-    fprintf(stepFile, "symbol[%d].follow.update(symbol[%d].follow)\n", dest,
-            src);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(MERGE_FOLLOW);
+        out->putInt(dest);
+        out->putInt(src);
+    } else {
+        out->printf("symbol[%d].follow.update(symbol[%d].follow)\n", dest,
+                    src);
+    }
     show(explain);
 }
 
 void mergeFollowFromFirst(int dest, int src, int eps, const char *explain) {
-    fprintf(stepFile,
-            "symbol[%d].follow.update(symbol[%d].first)\n"
-            "symbol[%d].follow.discard(%d)\n",
-            dest, src, dest, eps);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(MERGE_FOLLOW_FROM_FIRST);
+        out->putInt(dest);
+        out->putInt(src);
+        out->putInt(eps);
+    } else {
+        out->printf("symbol[%d].follow.update(symbol[%d].first)\n"
+                    "symbol[%d].follow.discard(%d)\n",
+                    dest, src, dest, eps);
+    }
     show(explain);
 }
 
 void addTableEntry(int state, int look_ahead, const char *action) {
-    fprintf(stepFile, "table[%d][%d].add('%s')\n", state, look_ahead, action);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(ADD_TABLE_ENTRY);
+        out->putInt(state);
+        out->putInt(look_ahead);
+        out->putString(action);
+        return;
+    }
+    out->printf("table[%d][%d].add('%s')\n", state, look_ahead, action);
+}
+
+void removeTableEntry(int state, int look_ahead, const char *action) {
+    if (!out)
+        return;
+    if (binary) {
+        out->put(REMOVE_TABLE_ENTRY);
+        out->putInt(state);
+        out->putInt(look_ahead);
+        out->putString(action);
+        return;
+    }
+    out->printf("table[%d][%d].discard('%s')\n", state, look_ahead, action);
 }
 
 void printf(const char *fmt, ...) {
+    if (!out)
+        return;
     va_list ap;
     va_start(ap, fmt);
-    vfprintf(stepFile, fmt, ap);
+    if (binary) {
+        char buf[256];
+        va_list copy;
+        va_copy(copy, ap);
+        int n = vsnprintf(buf, sizeof(buf), fmt, copy);
+        va_end(copy);
+        if (n >= 0) {
+            out->put(TEXT);
+            if (static_cast<size_t>(n) < sizeof(buf)) {
+                out->putString(std::string_view(buf, n));
+            } else {
+                std::string s(n + 1, '\0');
+                vsnprintf(s.data(), s.size(), fmt, ap);
+                out->putString(std::string_view(s.data(), n));
+            }
+        }
+    } else {
+        out->vprintf(fmt, ap);
+    }
+    va_end(ap);
 }
 
 void addState(int state, std::string_view description) {
-    std::string s = escape_ascii(description);
-    fprintf(stepFile, "addState(%d, \"%s\")\n", state, s.c_str());
+    if (!out)
+        return;
+    if (binary) {
+        out->put(ADD_STATE);
+        out->putInt(state);
+        out->putString(description);
+        return;
+    }
+    out->printf("addState(%d, \"", state);
+    putEscaped(description);
+    out->write("\")\n");
 }
 
 void updateState(int state, std::string_view description) {
-    std::string s = escape_ascii(description);
-    fprintf(stepFile, "updateState(%d, \"%s\")\n", state, s.c_str());
+    if (!out)
+        return;
+    if (binary) {
+        out->put(UPDATE_STATE);
+        out->putInt(state);
+        out->putString(description);
+        return;
+    }
+    out->printf("updateState(%d, \"", state);
+    putEscaped(description);
+    out->write("\")\n");
 }
 
 void addEdge(int s1, int s2, std::string_view label) {
-    std::string s = escape_ascii(label);
-    fprintf(stepFile, "addEdge(%d, %d, \"%s\")\n", s1, s2, s.c_str());
+    if (!out)
+        return;
+    if (binary) {
+        out->put(ADD_EDGE);
+        out->putInt(s1);
+        out->putInt(s2);
+        out->putString(label);
+        return;
+    }
+    out->printf("addEdge(%d, %d, \"", s1, s2);
+    putEscaped(label);
+    out->write("\")\n");
 }
 
-void setStart(int state) { fprintf(stepFile, "setStart(%d)\n", state); }
+void setStart(int state) {
+    if (!out)
+        return;
+    if (binary) {
+        out->put(SET_START);
+        out->putInt(state);
+        return;
+    }
+    out->printf("setStart(%d)\n", state);
+}
 
-void setFinal(int state) { fprintf(stepFile, "setFinal(%d)\n", state); }
+void setFinal(int state) {
+    if (!out)
+        return;
+    if (binary) {
+        out->put(SET_FINAL);
+        out->putInt(state);
+        return;
+    }
+    out->printf("setFinal(%d)\n", state);
+}
 
 void astAddNode(int index, std::string_view label) {
-    std::string s = escape_ascii(label);
-    fprintf(stepFile, "astAddNode(%d, \"%s\")\n", index, s.c_str());
+    if (!out)
+        return;
+    if (binary) {
+        out->put(AST_ADD_NODE);
+        out->putInt(index);
+        out->putString(label);
+        return;
+    }
+    out->printf("astAddNode(%d, \"", index);
+    putEscaped(label);
+    out->write("\")\n");
 }
 
 void astSetParent(int child, int parent) {
-    fprintf(stepFile, "astSetParent(%d, %d)\n", child, parent);
+    if (!out)
+        return;
+    if (binary) {
+        out->put(AST_SET_PARENT);
+        out->putInt(child);
+        out->putInt(parent);
+        return;
+    }
+    out->printf("astSetParent(%d, %d)\n", child, parent);
 }
 
 void show(const char *message) {
@@ -114,13 +364,29 @@ void show(const char *message) {
 }
 
 void show(std::string_view message) {
-    std::string s = escape_ascii(message);
-    fprintf(stepFile, "show(\"%s\")\n", s.data());
+    if (!out)
+        return;
+    if (binary) {
+        out->put(SHOW);
+        out->putString(message);
+        return;
+    }
+    out->write("show(\"");
+    putEscaped(message);
+    out->write("\")\n");
 }
 
 void section(std::string_view title) {
-    std::string s = escape_ascii(title);
-    fprintf(stepFile, "section(\"%s\")\n", s.data());
+    if (!out)
+        return;
+    if (binary) {
+        out->put(SECTION);
+        out->putString(title);
+        return;
+    }
+    out->write("section(\"");
+    putEscaped(title);
+    out->write("\")\n");
 }
 
-} // namespace step
\ No newline at end of file
+} // namespace step
@@ -7,6 +7,15 @@ namespace step {
 
 // void stepPrepare(int nsym, int nprod);
 // void stepFinish();
+// Starts writing steps to `path`, as Python statements for the GUI or, if
+// `binary` is set, as records which gui/StepTrace.py converts to them.
+// Returns false if the file cannot be opened.
+bool open(const char *path, bool binary);
+// Writes out the steps and closes the file. Returns false if a write failed.
+bool close();
+// Whether steps are being written. All functions below do nothing otherwise,
+// so callers only need to check it to skip building expensive messages.
+bool enabled();
 void nullable(int symbol, bool nullable, const char *explain);
 void symbol(int id, const char *name, bool is_term, bool is_start);
 void production(int id, int head, const int *body, size_t body_size);
@@ -16,6 +25,7 @@ void mergeFirst(int dest, int src, const char *explain);
 void mergeFollow(int dest, int src, const char *explain);
 void mergeFollowFromFirst(int dest, int src, int eps, const char *explain);
 void addTableEntry(int state, int look_ahead, const char *action);
+void removeTableEntry(int state, int look_ahead, const char *action);
 void printf(const char *fmt, ...);
 void addState(int state, std::string_view description);
 void updateState(int state, std::string_view description);
@@ -81,10 +81,12 @@ void Grammar::addAlias(SymbolID id, const char *alias) {
 }
 
 ProductionID Grammar::addProduction(SymbolID leftSymbol,
-                                    std::vector<SymbolID> rightSymbols) {
+                                    std::vector<SymbolID> rightSymbols,
+                                    SymbolID precSymbol) {
     // Production ID
     auto id = (ProductionID)productionTable.size();
-    productionTable.emplace_back(leftSymbol, std::move(rightSymbols));
+    productionTable.emplace_back(leftSymbol, std::move(rightSymbols),
+                                 precSymbol);
     symbols[leftSymbol].productions.push_back(id);
     return id;
 }
@@ -103,12 +105,12 @@ std::string Grammar::dump() const {
         s += f.formatView(
             "    %zd) %s %s", i, vec[i].name.c_str(),
             vec[i].type == SymbolType::TERM ? "[TERM" : "[NONTERM");
-        if (vec[i].id == getStartSymbol().id) {
+        if (isStartSymbol(vec[i].id)) {
             s += ",START";
         }
         s += "]\n";
         step::symbol(i, vec[i].name.c_str(), vec[i].type == SymbolType::TERM,
-                   vec[i].id == getStartSymbol().id);
+                   isStartSymbol(vec[i].id));
     }
 
     s += "Productions:";
@@ -144,13 +146,21 @@ auto Grammar::fromFile(const char *fileName) -> Grammar {
         throw std::runtime_error(std::string("File not found: ") + fileName);
     }
     auto g = GrammarReader::parse(stream);
+    g.reduce(launchArgs.reduce);
+    if (launchArgs.transform)
+        g.transform(launchArgs.parserType == LL1);
     display(GRAMMAR_RULES, INFO, "Grammar rules has been parsed", &g);
     g.calAttributes();
     return g;
 }
 
 auto Grammar::fromStdin() -> Grammar {
-    return GrammarReader::parse(::std::cin).calAttributes();
+    auto g = GrammarReader::parse(::std::cin);
+    g.reduce(launchArgs.reduce);
+    if (launchArgs.transform)
+        g.transform(launchArgs.parserType == LL1);
+    g.calAttributes();
+    return g;
 }
 
 void Grammar::checkViolations() {
@@ -161,15 +171,600 @@ void Grammar::checkViolations() {
         }
     }
     // TODO: check if there's a A -> A
+
+    for (auto &sym : symbols) {
+        if (sym.precedence && sym.type != SymbolType::TERM) {
+            throw std::runtime_error("Precedence is declared for non-terminal " +
+                                     sym.name);
+        }
+    }
+
+    for (auto start : starts) {
+        if (symbols[start].type != SymbolType::NON_TERM) {
+            throw std::runtime_error("Start symbol " + symbols[start].name +
+                                     " has no productions");
+        }
+    }
+
+    // "error" is reserved for error recovery. It's only a symbol if some
+    // production uses it.
+    auto it = idTable.find(Constants::error_token);
+    if (it != idTable.end()) {
+        if (symbols[it->second].type != SymbolType::TERM) {
+            throw std::runtime_error(
+                "\"error\" is reserved for error recovery and cannot be a "
+                "non-terminal");
+        }
+        error = it->second;
+    }
+}
+
+void Grammar::addPrecedenceLevel(Associativity assoc,
+                                 std::vector<SymbolID> const &terminals) {
+    ++precedenceLevels;
+    for (auto id : terminals) {
+        auto &sym = symbols[id];
+        if (sym.precedence) {
+            throw std::runtime_error("Precedence of " + sym.name +
+                                     " is declared twice");
+        }
+        sym.precedence = precedenceLevels;
+        sym.associativity = assoc;
+    }
 }
 
-// setStart() should only be called once.
-void Grammar::setStart(const char *name) {
+void Grammar::resolvePrecedences() {
+    for (auto &prod : productionTable) {
+        if (prod.precSymbol >= 0)
+            continue;
+        auto const &rhs = prod.rightSymbols;
+        auto it = std::find_if(rhs.rbegin(), rhs.rend(), [this](SymbolID id) {
+            return symbols[id].type == SymbolType::TERM;
+        });
+        if (it != rhs.rend())
+            prod.precSymbol = *it;
+    }
+}
+
+void Grammar::addStart(const char *name) {
     // Although we know start symbol must not be a terminal,
     // we cannot define it here, we need to check symbol later.
-    start = putSymbolUnchecked(name);
+    auto id = putSymbolUnchecked(name);
+    if (!isStartSymbol(id))
+        starts.push_back(id);
+}
+
+Grammar &Grammar::reduce(bool drop) {
+    auto nSymbols = symbols.size();
+    auto nProductions = productionTable.size();
+
+    // A nonterminal is productive once all symbols of one of its productions
+    // are. Like calNullable(), count the symbols left of each production.
+    std::vector<bool> productive(nSymbols, false);
+    std::vector<int> remaining(nProductions);
+    std::vector<std::vector<ProductionID>> occurrences(nSymbols);
+    std::vector<SymbolID> worklist;
+    for (auto const &sym : symbols) {
+        if (sym.type == SymbolType::TERM) {
+            productive[sym.id] = true;
+            worklist.push_back(sym.id);
+        }
+    }
+    for (size_t i = 0; i < nProductions; ++i) {
+        auto const &rhs = productionTable[i].rightSymbols;
+        remaining[i] = static_cast<int>(rhs.size());
+        for (auto right : rhs)
+            occurrences[right].push_back(static_cast<ProductionID>(i));
+    }
+    auto productiveBy = [&](ProductionID pid) {
+        auto left = productionTable[pid].leftSymbol;
+        if (!productive[left]) {
+            productive[left] = true;
+            worklist.push_back(left);
+        }
+    };
+    for (size_t i = 0; i < nProductions; ++i)
+        if (remaining[i] == 0)
+            productiveBy(static_cast<ProductionID>(i));
+    while (!worklist.empty()) {
+        auto sym = worklist.back();
+        worklist.pop_back();
+        for (auto pid : occurrences[sym])
+            if (--remaining[pid] == 0)
+                productiveBy(pid);
+    }
 
-    // Since this is the start, there are no productions yet.
+    // Only productions of productive symbols lead to reachable symbols.
+    std::vector<bool> reachable(nSymbols, false);
+    for (auto start : starts) {
+        reachable[start] = true;
+        worklist.push_back(start);
+    }
+    while (!worklist.empty()) {
+        auto sym = worklist.back();
+        worklist.pop_back();
+        for (auto pid : symbols[sym].productions) {
+            if (remaining[pid] != 0)
+                continue;
+            for (auto right : productionTable[pid].rightSymbols) {
+                if (!reachable[right]) {
+                    reachable[right] = true;
+                    worklist.push_back(right);
+                }
+            }
+        }
+    }
+
+    util::Formatter f;
+    std::vector<bool> usefulSymbol(nSymbols, true);
+    size_t uselessSymbols = 0;
+    for (auto const &sym : symbols) {
+        if (sym.type != SymbolType::NON_TERM)
+            continue;
+        const char *reason = !productive[sym.id] ? "derives no terminal string"
+                             : !reachable[sym.id]
+                                 ? "cannot be reached from a start symbol"
+                                 : nullptr;
+        if (!reason)
+            continue;
+        if (drop && isStartSymbol(sym.id))
+            throw std::runtime_error("Start symbol " + sym.name + " " +
+                                     reason);
+        usefulSymbol[sym.id] = false;
+        ++uselessSymbols;
+        display(LOG, WARN,
+                f.formatView("Nonterminal %s is useless: it %s",
+                             sym.name.c_str(), reason)
+                    .data());
+    }
+    std::vector<bool> usefulProduction(nProductions, true);
+    size_t uselessProductions = 0;
+    for (size_t i = 0; i < nProductions; ++i) {
+        auto const &prod = productionTable[i];
+        if (usefulSymbol[prod.leftSymbol] &&
+            std::all_of(prod.rightSymbols.begin(), prod.rightSymbols.end(),
+                        [&](SymbolID s) { return usefulSymbol[s]; }))
+            continue;
+        usefulProduction[i] = false;
+        ++uselessProductions;
+        display(LOG, WARN,
+                f.formatView("Production %zu) %s is useless", i,
+                             dumpProduction(prod).c_str())
+                    .data());
+    }
+    if (!uselessProductions)
+        return *this;
+    if (!drop) {
+        display(LOG, WARN, "Use --reduce to remove useless productions");
+        return *this;
+    }
+
+    removeSymbols(usefulSymbol, usefulProduction);
+    display(LOG, VERBOSE,
+            f.formatView("Removed %zu nonterminal(s) and %zu production(s)",
+                         uselessSymbols, uselessProductions)
+                .data());
+    return *this;
+}
+
+std::vector<SymbolID>
+Grammar::removeSymbols(std::vector<bool> const &keptSymbols,
+                       std::vector<bool> const &keptProductions) {
+    // Relative orders are kept.
+    std::vector<SymbolID> symbolMap(symbols.size(), SymbolID{-1});
+    symvec_t newSymbols;
+    for (auto &sym : symbols) {
+        if (!keptSymbols[sym.id])
+            continue;
+        auto id = static_cast<SymbolID>(newSymbols.size());
+        symbolMap[sym.id] = id;
+        sym.id = id;
+        sym.productions.clear();
+        newSymbols.push_back(std::move(sym));
+    }
+    ProductionTable newProductions;
+    for (size_t i = 0; i < productionTable.size(); ++i) {
+        if (!keptProductions[i])
+            continue;
+        auto &prod = productionTable[i];
+        for (auto &right : prod.rightSymbols)
+            right = symbolMap[right];
+        auto left = symbolMap[prod.leftSymbol];
+        auto prec = prod.precSymbol >= 0 ? symbolMap[prod.precSymbol]
+                                         : SymbolID{-1};
+        newSymbols[left].productions.push_back(
+            static_cast<ProductionID>(newProductions.size()));
+        newProductions.emplace_back(left, std::move(prod.rightSymbols), prec);
+    }
+    symbols = std::move(newSymbols);
+    productionTable = std::move(newProductions);
+
+    // Aliases are in the table too.
+    for (auto it = idTable.begin(); it != idTable.end();) {
+        if (symbolMap[it->second] < 0) {
+            it = idTable.erase(it);
+        } else {
+            it->second = symbolMap[it->second];
+            ++it;
+        }
+    }
+    for (auto &start : starts)
+        start = symbolMap[start];
+    epsilon = symbolMap[epsilon];
+    endOfInput = symbolMap[endOfInput];
+    if (error >= 0)
+        error = symbolMap[error];
+    return symbolMap;
+}
+
+Grammar &Grammar::transform(bool factor) {
+    originalProductions = productionTable;
+    origins.clear();
+    origins.reserve(productionTable.size());
+    for (size_t i = 0; i < productionTable.size(); ++i) {
+        auto const &prod = productionTable[i];
+        origins.push_back({{static_cast<ProductionID>(i), prod.leftSymbol,
+                            static_cast<int>(prod.rightSymbols.size())}});
+    }
+
+    auto inlined = inlineSingleUse();
+    auto factored = factor ? leftFactor() : 0;
+    if (inlined.empty() && !factored) {
+        // Reductions need no mapping.
+        originalProductions.clear();
+        origins.clear();
+        return *this;
+    }
+    compactProductions();
+
+    // Inlined nonterminals would still get a GOTO column, First and Follow
+    // sets and NFA states, so they are removed. Listeners still receive
+    // their reductions, so they are numbered after the remaining symbols.
+    if (!inlined.empty()) {
+        std::vector<bool> kept(symbols.size(), true);
+        symvec_t removed;
+        for (auto id : inlined) {
+            kept[id] = false;
+            removed.push_back(symbols[id]);
+        }
+        auto symbolMap = removeSymbols(
+            kept, std::vector<bool>(productionTable.size(), true));
+        originalSymbols = symbols;
+        for (auto &sym : removed) {
+            auto id = static_cast<SymbolID>(originalSymbols.size());
+            symbolMap[sym.id] = id;
+            sym.id = id;
+            originalSymbols.push_back(std::move(sym));
+        }
+        for (auto &prod : originalProductions) {
+            prod.leftSymbol = symbolMap[prod.leftSymbol];
+            for (auto &right : prod.rightSymbols)
+                right = symbolMap[right];
+            if (prod.precSymbol >= 0)
+                prod.precSymbol = symbolMap[prod.precSymbol];
+        }
+        for (auto &reductions : origins)
+            for (auto &r : reductions)
+                r.head = symbolMap[r.head];
+    }
+
+    util::Formatter f;
+    display(LOG, VERBOSE,
+            f.formatView("Grammar is transformed: %zu nonterminal(s) inlined, "
+                         "%zu prefix(es) factored",
+                         inlined.size(), factored)
+                .data());
+    return *this;
+}
+
+std::vector<SymbolID> Grammar::inlineSingleUse() {
+    // Number of uses of each symbol in right sides, and the production of
+    // the last one.
+    std::vector<int> uses(symbols.size(), 0);
+    std::vector<ProductionID> user(symbols.size(), ProductionID{-1});
+    for (size_t i = 0; i < productionTable.size(); ++i) {
+        for (auto right : productionTable[i].rightSymbols) {
+            ++uses[right];
+            user[right] = static_cast<ProductionID>(i);
+        }
+    }
+
+    // Only the last symbol of a production is inlined. Listeners can then
+    // replay the reductions of its body when the production is reduced,
+    // because the body is still at the top of their stacks. Inlining never
+    // makes another symbol eligible, so one pass is enough.
+    std::vector<SymbolID> inlined;
+    for (auto &sym : symbols) {
+        auto id = sym.id;
+        if (sym.type != SymbolType::NON_TERM || isStartSymbol(id) ||
+            uses[id] != 1 || sym.productions.empty())
+            continue;
+        auto userID = user[id];
+        auto const prod = productionTable[userID];
+        if (prod.leftSymbol == id || prod.rightSymbols.back() != id)
+            continue;
+        // A prefix repeated for every body would add NFA states, or be
+        // factored out again.
+        if (sym.productions.size() > 1 && prod.rightSymbols.size() > 1)
+            continue;
+
+        std::vector<ProductionID> replacements;
+        for (auto body : sym.productions) {
+            auto newID = static_cast<ProductionID>(productionTable.size());
+            auto rhs = prod.rightSymbols;
+            rhs.pop_back();
+            for (auto right : productionTable[body].rightSymbols) {
+                rhs.push_back(right);
+                user[right] = newID;
+            }
+            // Reduce the body first, and then the production using it.
+            // Conflicts on the reduction are those of the body's.
+            auto origin = origins[body];
+            origin.insert(origin.end(), origins[userID].begin(),
+                          origins[userID].end());
+            productionTable.emplace_back(prod.leftSymbol, std::move(rhs),
+                                         productionTable[body].precSymbol);
+            origins.push_back(std::move(origin));
+            replacements.push_back(newID);
+        }
+        auto &list = symbols[prod.leftSymbol].productions;
+        auto pos = list.erase(std::find(list.begin(), list.end(), userID));
+        list.insert(pos, replacements.begin(), replacements.end());
+        sym.productions.clear();
+        uses[id] = 0;
+        inlined.push_back(id);
+    }
+    return inlined;
+}
+
+size_t Grammar::leftFactor() {
+    std::vector<SymbolID> worklist;
+    for (auto const &sym : symbols)
+        if (sym.type == SymbolType::NON_TERM)
+            worklist.push_back(sym.id);
+
+    size_t count = 0;
+    // Synthetic symbols are appended, and factored in turn.
+    for (size_t k = 0; k < worklist.size(); ++k) {
+        auto owner = worklist[k];
+        for (size_t i = 0; i < symbols[owner].productions.size(); ++i) {
+            auto const &list = symbols[owner].productions;
+            auto const &rhs = productionTable[list[i]].rightSymbols;
+            if (rhs.empty())
+                continue;
+            // Alternatives starting with the same symbol, and the length of
+            // their common prefix.
+            std::vector<size_t> members{i};
+            auto prefixLength = rhs.size();
+            for (size_t j = i + 1; j < list.size(); ++j) {
+                auto const &other = productionTable[list[j]].rightSymbols;
+                if (other.empty() || other.front() != rhs.front())
+                    continue;
+                members.push_back(j);
+                auto mismatch = std::mismatch(rhs.begin(), rhs.end(),
+                                              other.begin(), other.end());
+                prefixLength = std::min(
+                    prefixLength,
+                    static_cast<size_t>(mismatch.first - rhs.begin()));
+            }
+            if (members.size() < 2)
+                continue;
+
+            std::string name = symbols[owner].name + "'";
+            while (idTable.count(name))
+                name += "'";
+            auto helper = putSymbol(name.c_str(), false);
+            symbols[helper].synthetic = true;
+            worklist.push_back(helper);
+
+            // owner -> prefix helper
+            // helper -> suffix | suffix | ...
+            // The factored production stands for nothing by itself: the
+            // helper's production which is reduced decides the alternative.
+            auto prefix = productionTable[symbols[owner].productions[i]]
+                              .rightSymbols;
+            prefix.resize(prefixLength);
+            prefix.push_back(helper);
+            // Suffixes keep the precedences of the alternatives, and the
+            // factored production has theirs if they agree.
+            std::vector<ProductionID> suffixes;
+            auto prec = productionTable[symbols[owner].productions[i]]
+                            .precSymbol;
+            for (auto m : members) {
+                auto pid = symbols[owner].productions[m];
+                auto const &full = productionTable[pid].rightSymbols;
+                auto memberPrec = productionTable[pid].precSymbol;
+                if (memberPrec != prec)
+                    prec = SymbolID{-1};
+                std::vector<SymbolID> suffix(full.begin() + prefixLength,
+                                             full.end());
+                suffixes.push_back(
+                    static_cast<ProductionID>(productionTable.size()));
+                productionTable.emplace_back(helper, std::move(suffix),
+                                             memberPrec);
+                origins.push_back(origins[pid]);
+            }
+            symbols[helper].productions = std::move(suffixes);
+
+            auto &ownerList = symbols[owner].productions;
+            ownerList[i] = static_cast<ProductionID>(productionTable.size());
+            productionTable.emplace_back(owner, std::move(prefix), prec);
+            origins.emplace_back();
+            for (auto m = members.size(); m-- > 1;)
+                ownerList.erase(ownerList.begin() +
+                                static_cast<std::ptrdiff_t>(members[m]));
+            ++count;
+        }
+    }
+    return count;
+}
+
+void Grammar::compactProductions() {
+    ProductionTable table;
+    std::vector<std::vector<OriginalReduction>> newOrigins;
+    std::vector<bool> emitted(symbols.size(), false);
+
+    // Symbols keep the order in which their productions first appeared, and
+    // each synthetic symbol follows the symbol it was factored from.
+    std::vector<SymbolID> pending;
+    auto emit = [&](SymbolID start) {
+        pending.push_back(start);
+        while (!pending.empty()) {
+            auto sym = pending.back();
+            pending.pop_back();
+            if (emitted[sym])
+                continue;
+            emitted[sym] = true;
+            auto &list = symbols[sym].productions;
+            std::vector<SymbolID> helpers;
+            for (auto &pid : list) {
+                auto &prod = productionTable[pid];
+                if (!prod.rightSymbols.empty() &&
+                    symbols[prod.rightSymbols.back()].synthetic)
+                    helpers.push_back(prod.rightSymbols.back());
+                auto newID = static_cast<ProductionID>(table.size());
+                table.emplace_back(sym, std::move(prod.rightSymbols),
+                                   prod.precSymbol);
+                newOrigins.push_back(std::move(origins[pid]));
+                pid = newID;
+            }
+            pending.insert(pending.end(), helpers.rbegin(), helpers.rend());
+        }
+    };
+    for (auto const &prod : originalProductions)
+        emit(prod.leftSymbol);
+
+    productionTable = std::move(table);
+    origins = std::move(newOrigins);
+}
+
+// Edge of a dependency graph between symbols: the set of the source symbol
+// includes the set of `to`, because of the symbol at `index` of `prod`.
+struct Dependency {
+    SymbolID to;
+    ProductionID prod;
+    int index;
+};
+
+// Propagates sets along a dependency graph, so that each symbol ends up
+// with the union of the sets it depends on. `merge(from, dep)` merges the
+// set of dep.to into the set of `from`.
+//
+// Strongly connected components are found with Tarjan's algorithm, which
+// emits them in reverse topological order, so the components a component
+// depends on are final when it is reached. Inside a component, the sets are
+// gathered into one member and then distributed to the others, along the
+// edges of the graph. So every merge is a real relation of the grammar and
+// each edge is merged at most twice.
+template <class Merge>
+static void propagate(std::vector<std::vector<Dependency>> const &deps,
+                      Merge &&merge) {
+    auto n = static_cast<int>(deps.size());
+    std::vector<int> order(n, -1), low(n, 0), component(n, -1);
+    std::vector<int> sccStack;
+    // Call stack of the depth-first search: node and next edge.
+    std::vector<std::pair<int, size_t>> callStack;
+    int counter = 0, components = 0;
+
+    // Scratch space of the components.
+    std::vector<int> members, local(n, -1);
+    std::vector<std::vector<std::pair<int, Dependency const *>>> reverse;
+    std::vector<int> bfs;
+    std::vector<Dependency const *> via;
+
+    auto finish = [&](int root) {
+        members.clear();
+        int v;
+        do {
+            v = sccStack.back();
+            sccStack.pop_back();
+            component[v] = components;
+            members.push_back(v);
+        } while (v != root);
+
+        // Components depended on are final.
+        for (int u : members)
+            for (auto const &dep : deps[u])
+                if (component[dep.to] != components)
+                    merge(u, dep);
+
+        if (members.size() > 1) {
+            for (int i = 0; i < (int)members.size(); ++i)
+                local[members[i]] = i;
+            // Gather into the root along a breadth-first tree of edges
+            // leaving it, children first.
+            bfs.assign(1, root);
+            via.assign(members.size(), nullptr);
+            std::vector<int> parent(members.size(), -1);
+            parent[local[root]] = root;
+            for (size_t head = 0; head < bfs.size(); ++head) {
+                int u = bfs[head];
+                for (auto const &dep : deps[u]) {
+                    if (component[dep.to] != components ||
+                        parent[local[dep.to]] >= 0)
+                        continue;
+                    parent[local[dep.to]] = u;
+                    via[local[dep.to]] = &dep;
+                    bfs.push_back(dep.to);
+                }
+            }
+            for (auto i = bfs.size(); i-- > 1;)
+                merge(parent[local[bfs[i]]], *via[local[bfs[i]]]);
+
+            // Distribute from the root along a breadth-first tree of edges
+            // entering it, parents first.
+            reverse.assign(members.size(), {});
+            for (int u : members)
+                for (auto const &dep : deps[u])
+                    if (component[dep.to] == components && dep.to != u)
+                        reverse[local[dep.to]].emplace_back(u, &dep);
+            std::vector<bool> reached(members.size(), false);
+            reached[local[root]] = true;
+            bfs.assign(1, root);
+            for (size_t head = 0; head < bfs.size(); ++head) {
+                for (auto [u, dep] : reverse[local[bfs[head]]]) {
+                    if (reached[local[u]])
+                        continue;
+                    reached[local[u]] = true;
+                    merge(u, *dep);
+                    bfs.push_back(u);
+                }
+            }
+            for (int u : members)
+                local[u] = -1;
+        }
+        ++components;
+    };
+
+    for (int start = 0; start < n; ++start) {
+        if (order[start] >= 0)
+            continue;
+        order[start] = low[start] = counter++;
+        sccStack.push_back(start);
+        callStack.emplace_back(start, 0);
+        while (!callStack.empty()) {
+            auto &[u, next] = callStack.back();
+            if (next < deps[u].size()) {
+                int v = deps[u][next++].to;
+                if (order[v] < 0) {
+                    order[v] = low[v] = counter++;
+                    sccStack.push_back(v);
+                    callStack.emplace_back(v, 0);
+                } else if (component[v] < 0) {
+                    low[u] = std::min(low[u], order[v]);
+                }
+                continue;
+            }
+            int done = u;
+            callStack.pop_back();
+            if (!callStack.empty()) {
+                int caller = callStack.back().first;
+                low[caller] = std::min(low[caller], low[done]);
+            }
+            if (low[done] == order[done])
+                finish(done);
+        }
+    }
 }
 
 void Grammar::calNullable() {
@@ -185,29 +780,47 @@ void Grammar::calNullable() {
     // Explain here.
     step::show("Epsilon is nullable, while other terminals are not.");
 
-    bool change = true;
-    while (change) {
-        change = false;
-        for (auto &prod : productionTable) {
-            bool nullableFlag = true;
-            for (auto rhs : prod.rightSymbols) {
-                nullableFlag = nullableFlag && symbols[rhs].nullable;
-            }
-            auto &left = symbols[prod.leftSymbol];
-            if (nullableFlag && !left.nullable) {
-                change = true;
-                left.nullable = nullableFlag;
-                // Build message.
-                std::string msg;
-                msg.reserve(128);
-                msg += "Production ";
-                msg += dumpProduction(prod);
-                msg += " can be null, so ";
-                msg += left.name;
-                msg += " is nullable.";
-                step::nullable(prod.leftSymbol, true, msg.c_str());
-            }
+    // A production can be null once all symbols of its right side are known
+    // to be nullable. Count the symbols left of each production, and visit
+    // the productions a symbol occurs in when it becomes nullable.
+    std::vector<int> remaining(productionTable.size());
+    std::vector<std::vector<ProductionID>> occurrences(symbols.size());
+    for (size_t i = 0; i < productionTable.size(); ++i) {
+        auto const &rhs = productionTable[i].rightSymbols;
+        remaining[i] = static_cast<int>(rhs.size());
+        for (auto right : rhs)
+            occurrences[right].push_back(static_cast<ProductionID>(i));
+    }
+
+    std::vector<SymbolID> worklist{epsilon};
+    auto nullableBy = [&](ProductionID pid) {
+        auto const &prod = productionTable[pid];
+        auto &left = symbols[prod.leftSymbol];
+        if (left.nullable)
+            return;
+        left.nullable = true;
+        worklist.push_back(prod.leftSymbol);
+        if (step::enabled()) {
+            // Build message.
+            std::string msg;
+            msg.reserve(128);
+            msg += "Production ";
+            msg += dumpProduction(prod);
+            msg += " can be null, so ";
+            msg += left.name;
+            msg += " is nullable.";
+            step::nullable(prod.leftSymbol, true, msg.c_str());
         }
+    };
+    for (size_t i = 0; i < productionTable.size(); ++i)
+        if (remaining[i] == 0)
+            nullableBy(static_cast<ProductionID>(i));
+    while (!worklist.empty()) {
+        auto sym = worklist.back();
+        worklist.pop_back();
+        for (auto pid : occurrences[sym])
+            if (--remaining[pid] == 0)
+                nullableBy(pid);
     }
 
     // Synchronize nullable attributes with GUI.
@@ -228,48 +841,40 @@ void Grammar::calFirst() {
     // Explain here.
     step::show("First set of each terminal only contains itself.");
 
-    bool change = true;
-    while (change) {
-        change = false;
-        for (auto &left : symbols) {
-            if (left.type == SymbolType::TERM)
-                continue;
-            auto newFirst = Symbol::SymbolSet();
-            for (auto &pindex : left.productions) {
-                auto const &rhs = productionTable[pindex].rightSymbols;
-    //            if (rhs.empty() && !left.firstSet.contains(epsilon)) {
-    //                step::addFirst(
-    //                    left.id, epsilon,
-    //                    "Any nullable symbol has ε in its First set.");
-    //                left.firstSet.insert(epsilon);
-    //                continue;
-    //            }
-                for (auto right : rhs) {
-                    newFirst |= symbols[right].firstSet;
-                    step::mergeFirst(left.id, right, nullptr); // No expl.
-                    if (!symbols[right].nullable)
-                        break;
-                }
-
-                if (!left.firstSet.supersetOf(newFirst)) {
-                    change = true;
-                    left.firstSet |= newFirst;
-                    std::string msg =
-                        "<div>Rule: If X → Y<sub>1</sub>Y<sub>2</sub>…Y<sub>x</sub>Y<sub>y</sub>…, and Y<sub>1</sub>Y<sub>2</sub>…Y<sub>x</sub> are all "
-                        "nullable, <br/>but Y<sub>y</sub> is not nullable, it follows that First(a) ⊆ First(X) "
-                        "for a ∈ {Y<sub>1</sub>, Y<sub>2</sub>, …, Y<sub>x</sub>}.<br/>";
-                    msg += "First set of symbol ";
-                    msg += left.name;
-                    msg += " is updated by production ";
-                    msg += dumpProductionHtml(pindex, (int)rhs.size());
-                    msg += ".";
-                    msg += "</div>";
-                    step::show(msg);
-                }
-            }
+    // First(X) includes First(Y) for the symbols of X → …Y… up to the first
+    // one which is not nullable.
+    std::vector<std::vector<Dependency>> deps(symbols.size());
+    for (size_t i = 0; i < productionTable.size(); ++i) {
+        auto const &prod = productionTable[i];
+        auto const &rhs = prod.rightSymbols;
+        for (int index = 0; index < (int)rhs.size(); ++index) {
+            deps[prod.leftSymbol].push_back(
+                {rhs[index], static_cast<ProductionID>(i), index});
+            if (!symbols[rhs[index]].nullable)
+                break;
         }
     }
 
+    propagate(deps, [this](int from, Dependency const &dep) {
+        auto &left = symbols[from];
+        if (!left.firstSet.orAssignChanged(symbols[dep.to].firstSet))
+            return;
+        step::mergeFirst(from, dep.to, nullptr); // No expl.
+        if (!step::enabled())
+            return;
+        std::string msg =
+            "<div>Rule: If X → Y<sub>1</sub>Y<sub>2</sub>…Y<sub>x</sub>Y<sub>y</sub>…, and Y<sub>1</sub>Y<sub>2</sub>…Y<sub>x</sub> are all "
+            "nullable, <br/>but Y<sub>y</sub> is not nullable, it follows that First(a) ⊆ First(X) "
+            "for a ∈ {Y<sub>1</sub>, Y<sub>2</sub>, …, Y<sub>x</sub>}.<br/>";
+        msg += "First set of symbol ";
+        msg += left.name;
+        msg += " is updated by production ";
+        msg += dumpProductionHtml(dep.prod, dep.index);
+        msg += ".";
+        msg += "</div>";
+        step::show(msg);
+    });
+
     // Add epsilon into First set.
     for (auto &sym : symbols) {
         if (sym.nullable) {
@@ -281,63 +886,73 @@ void Grammar::calFirst() {
 }
 
 void Grammar::calFollow() {
-    symbols[start].followSet.insert(endOfInput);
-    step::addFollow(start, endOfInput, "Follow set of start symbol contains $");
+    for (auto start : starts) {
+        symbols[start].followSet.insert(endOfInput);
+        step::addFollow(start, endOfInput,
+                        "Follow set of start symbol contains $");
+    }
 
+    // First(b) ⊆ Follow(B) for A → aBb, where b is every symbol after B up
+    // to the first one which is not nullable.
     for (auto const &production : productionTable) {
-        // auto lhs = production.leftSymbol;
         auto const &rhs = production.rightSymbols;
         auto len = (int)rhs.size();
         for (int i = 0; i + 1 < len; ++i) { // i and i+1 both have elements
-            if (symbols[rhs[i]].type == SymbolType::NON_TERM) {
-                symbols[rhs[i]].followSet |= symbols[rhs[i+1]].firstSet;
-                step::mergeFollowFromFirst(rhs[i], rhs[i+1], epsilon, nullptr);
-
-                // GUI message
-                std::string msg =
-                    "Rule: If A → aBb ∈ P, First(b) - {ε} ⊆ Follow(B).<br/>";
-                msg += "Follow set of symbol ";
-                msg += symbols[rhs[i]].name;
-                msg += " is updated by production ";
-                msg += dumpProductionHtml(production, i);
-                msg += ".";
-                step::show(msg);
-            }
-        }
-    }
-
-    std::string rule = "Rule: If A → aBb ∈ P and b is nullable, or A → aB, "
-                       "then Follow(A) ⊆ Follow(B).<br/>";
-
-    bool change = true;
-    while (change) {
-        change = false;
-        for (auto const &production : productionTable) {
-            auto lhs = production.leftSymbol;
-            auto const &rhs = production.rightSymbols;
-            auto len = (int)rhs.size();
-            for (int i = len - 1; i >= 0; --i) {
-                if (symbols[rhs[i]].type == SymbolType::NON_TERM) {
-                    auto newFollow = symbols[rhs[i]].followSet;
-                    newFollow |= symbols[lhs].followSet;
-                    if (newFollow != symbols[rhs[i]].followSet) { // Update
-                        symbols[rhs[i]].followSet = newFollow;
-                        change = true;
-                        std::string msg = rule;
+            if (symbols[rhs[i]].type != SymbolType::NON_TERM)
+                continue;
+            auto &follow = symbols[rhs[i]].followSet;
+            for (int j = i + 1; j < len; ++j) {
+                if (follow.orAssignChanged(symbols[rhs[j]].firstSet)) {
+                    step::mergeFollowFromFirst(rhs[i], rhs[j], epsilon,
+                                               nullptr);
+                    if (step::enabled()) {
+                        // GUI message
+                        std::string msg = "Rule: If A → aBb ∈ P, First(b) - "
+                                          "{ε} ⊆ Follow(B).<br/>";
                         msg += "Follow set of symbol ";
                         msg += symbols[rhs[i]].name;
                         msg += " is updated by production ";
                         msg += dumpProductionHtml(production, i);
                         msg += ".";
-                        step::mergeFollow(rhs[i], lhs, msg.c_str());
+                        step::show(msg);
                     }
                 }
-                if (!symbols[rhs[i]].nullable)
+                if (!symbols[rhs[j]].nullable)
                     break;
             }
         }
     }
 
+    // Follow(A) ⊆ Follow(B) for A → aBb where b is nullable.
+    std::vector<std::vector<Dependency>> deps(symbols.size());
+    for (size_t p = 0; p < productionTable.size(); ++p) {
+        auto const &production = productionTable[p];
+        auto const &rhs = production.rightSymbols;
+        for (int i = (int)rhs.size() - 1; i >= 0; --i) {
+            if (symbols[rhs[i]].type == SymbolType::NON_TERM)
+                deps[rhs[i]].push_back(
+                    {production.leftSymbol, static_cast<ProductionID>(p), i});
+            if (!symbols[rhs[i]].nullable)
+                break;
+        }
+    }
+
+    propagate(deps, [this](int from, Dependency const &dep) {
+        auto &follow = symbols[from].followSet;
+        if (!follow.orAssignChanged(symbols[dep.to].followSet))
+            return;
+        if (!step::enabled())
+            return;
+        std::string msg = "Rule: If A → aBb ∈ P and b is nullable, or A → aB, "
+                          "then Follow(A) ⊆ Follow(B).<br/>";
+        msg += "Follow set of symbol ";
+        msg += symbols[from].name;
+        msg += " is updated by production ";
+        msg += dumpProductionHtml(dep.prod, dep.index);
+        msg += ".";
+        step::mergeFollow(from, dep.to, msg.c_str());
+    });
+
     // For completion, remove epsilons from Follow sets.
     // The removal has no effect on calculation, though.
     for (auto &sym : symbols) {
@@ -345,6 +960,36 @@ void Grammar::calFollow() {
     }
 }
 
+void Grammar::calSuffixes() {
+    suffixOffsets.clear();
+    suffixOffsets.reserve(productionTable.size());
+    size_t total = 0;
+    for (auto const &production : productionTable) {
+        suffixOffsets.push_back(total);
+        total += production.rightSymbols.size() + 1;
+    }
+    suffixFirstSets.assign(total, Symbol::SymbolSet(symbols.size()));
+    suffixNullables.assign(total, true);
+
+    // From right to left: a suffix includes the next one only if its first
+    // symbol is nullable.
+    for (size_t p = 0; p < productionTable.size(); ++p) {
+        auto const &rhs = productionTable[p].rightSymbols;
+        auto offset = suffixOffsets[p];
+        for (auto i = rhs.size(); i-- > 0;) {
+            auto const &sym = symbols[rhs[i]];
+            auto &first = suffixFirstSets[offset + i];
+            first = sym.firstSet;
+            if (sym.nullable) {
+                first |= suffixFirstSets[offset + i + 1];
+                suffixNullables[offset + i] = suffixNullables[offset + i + 1];
+            } else {
+                suffixNullables[offset + i] = false;
+            }
+        }
+    }
+}
+
 Grammar &Grammar::calAttributes() {
     // classifySymbols();
 
@@ -354,6 +999,7 @@ Grammar &Grammar::calAttributes() {
     calNullable();
     calFirst();
     calFollow();
+    calSuffixes();
 
     // // Nullable
     // // Epsilon is nullable // This is done in resolveNullable
@@ -537,11 +1183,20 @@ const Symbol &Grammar::getEndOfInputSymbol() const {
     return symbols[endOfInput];
 }
 
+const Symbol &Grammar::getErrorSymbol() const {
+    if (error < 0) {
+        throw NoSuchSymbolError(Constants::error_token);
+    }
+    return symbols[error];
+}
+
 const Symbol &Grammar::getEpsilonSymbol() const {
     return symbols[epsilon];
 }
 
-const Symbol &Grammar::getStartSymbol() const { return symbols[start]; }
+const Symbol &Grammar::getStartSymbol() const {
+    return symbols[starts.front()];
+}
 
 const Grammar::symvec_t &Grammar::getAllSymbols() const { return symbols; }
 
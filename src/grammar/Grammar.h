@@ -1,6 +1,7 @@
 #ifndef LRPARSER_GRAM_H
 #define LRPARSER_GRAM_H
 
+#include <algorithm>
 #include <optional>
 #include <set>
 #include <stdexcept>
@@ -21,18 +22,40 @@ namespace gram {
 struct Production {
     SymbolID leftSymbol;
     std::vector<SymbolID> rightSymbols;
-    Production(SymbolID left, std::vector<SymbolID> right)
-        : leftSymbol(left), rightSymbols(std::move(right)) {}
+    // The terminal whose precedence the production has: the one named by
+    // %prec, or else the last terminal of the right side. -1 if there is
+    // none.
+    SymbolID precSymbol;
+    Production(SymbolID left, std::vector<SymbolID> right,
+               SymbolID prec = SymbolID{-1})
+        : leftSymbol(left), rightSymbols(std::move(right)), precSymbol(prec) {}
 };
 
 using ProductionTable = std::vector<Production>;
 
+// A reduction by a production of the grammar before Grammar::transform().
+struct OriginalReduction {
+    ProductionID prodID;
+    SymbolID head;
+    // Number of values replaced on a listener's stack.
+    int bodySize;
+};
+
 class Grammar;
 
+// Declared for terminals by %left, %right and %nonassoc.
+enum class Associativity { NONE, LEFT, RIGHT, NONASSOC };
+
 struct Symbol {
     using SymbolSet = util::BitSet<SymbolID>;
     // std::optional<bool> nullable;
     bool nullable;
+    // Made by Grammar::transform() when it left-factors productions.
+    bool synthetic = false;
+    // Level of the precedence declaration of a terminal. Later declarations
+    // bind tighter. 0 if it has none.
+    int precedence = 0;
+    Associativity associativity = Associativity::NONE;
     SymbolType type;
     SymbolID id;
     std::string name;
@@ -55,12 +78,31 @@ class Grammar {
 
   private:
     friend class GrammarReader;
-    SymbolID start{-1};
+    // Entry points of parsers. The first one is the default.
+    std::vector<SymbolID> starts;
     SymbolID epsilon{-1};
     SymbolID endOfInput{-1};
+    // The reserved "error" terminal. Only defined if the grammar uses it.
+    SymbolID error{-1};
     symvec_t symbols;
     idtbl_t idTable;
+    // Number of %left, %right and %nonassoc declarations.
+    int precedenceLevels = 0;
     ProductionTable productionTable;
+    // First sets and nullability of every suffix of every production, so
+    // lookaheads can be resolved with a single union. Suffixes of a
+    // production start at suffixOffsets[id], one per index of the right side
+    // plus the empty one.
+    std::vector<size_t> suffixOffsets;
+    std::vector<Symbol::SymbolSet> suffixFirstSets;
+    std::vector<bool> suffixNullables;
+    // Only filled by transform(): productions before it, and the reductions
+    // of them that each production stands for.
+    ProductionTable originalProductions;
+    std::vector<std::vector<OriginalReduction>> origins;
+    // Only filled if transform() inlines nonterminals: the symbols, followed
+    // by the inlined nonterminals which were removed from them.
+    symvec_t originalSymbols;
 
     // // Classification & Reorder
     // std::vector<int> nonterminals;
@@ -73,7 +115,8 @@ class Grammar {
     Grammar();
 
     ProductionID addProduction(SymbolID leftSymbol,
-                               std::vector<SymbolID> rightSymbols);
+                               std::vector<SymbolID> rightSymbols,
+                               SymbolID precSymbol = SymbolID{-1});
 
     // This method can detect duplicates. All symbol-putting methods should
     // eventually call this one.
@@ -87,7 +130,17 @@ class Grammar {
     // Throws if there are violations
     void checkViolations();
 
-    void setStart(const char *name);
+    // Declares another start symbol. Duplicates are ignored.
+    void addStart(const char *name);
+
+    // Declares the next precedence level, which binds tighter than the
+    // previous ones, for the given terminals.
+    void addPrecedenceLevel(Associativity assoc,
+                            std::vector<SymbolID> const &terminals);
+
+    // Gives the productions without %prec the precedence of their last
+    // terminal. Called once all symbols are known.
+    void resolvePrecedences();
 
     void addAlias(SymbolID sid, const char *alias);
 
@@ -112,13 +165,48 @@ class Grammar {
     void calNullable(); // Calculate nullable
     void calFirst();    // Calculate First
     void calFollow();   // Calculate Follow
+    void calSuffixes(); // Calculate First sets of production suffixes
+
+    // Passes of transform(). New productions are appended to the table and
+    // only the production lists of symbols are updated, so replaced ones are
+    // left behind until compactProductions() renumbers the table.
+    // inlineSingleUse() returns the inlined nonterminals, which are left
+    // without productions.
+    std::vector<SymbolID> inlineSingleUse();
+    size_t leftFactor();
+    void compactProductions();
+
+    // Removes the symbols and productions which are not kept, and renumbers
+    // the others in the same order. Returns the new ID of each symbol, or -1
+    // if it's removed.
+    std::vector<SymbolID> removeSymbols(std::vector<bool> const &keptSymbols,
+                                        std::vector<bool> const &keptProductions);
 
   public:
     [[nodiscard]] symvec_t const &getAllSymbols() const;
+    // The default start symbol.
     [[nodiscard]] const Symbol &getStartSymbol() const;
+    [[nodiscard]] auto const &getStartSymbols() const { return starts; }
+    [[nodiscard]] bool isStartSymbol(SymbolID id) const {
+        return std::find(starts.begin(), starts.end(), id) != starts.end();
+    }
     [[nodiscard]] const Symbol &getEpsilonSymbol() const;
     [[nodiscard]] const Symbol &getEndOfInputSymbol() const;
+    [[nodiscard]] bool hasErrorSymbol() const { return error >= 0; }
+    // Only valid if hasErrorSymbol() is true.
+    [[nodiscard]] const Symbol &getErrorSymbol() const;
     [[nodiscard]] ProductionTable const &getProductionTable() const;
+    // Union of the First sets of rhs[index], rhs[index+1], ... up to the
+    // first symbol which is not nullable. `index` may be the size of the right
+    // side, which gives an empty set. Only valid after calAttributes().
+    [[nodiscard]] Symbol::SymbolSet const &suffixFirstSet(ProductionID id,
+                                                          int index) const {
+        return suffixFirstSets[suffixOffsets[id] + index];
+    }
+    // Whether rhs[index], rhs[index+1], ... are all nullable.
+    [[nodiscard]] bool suffixNullable(ProductionID id, int index) const {
+        return suffixNullables[suffixOffsets[id] + index];
+    }
     [[nodiscard]] std::string dump() const;
     [[nodiscard]] static std::string dumpNullable(const Symbol &symbol);
     [[nodiscard]] std::string dumpFirstSet(const Symbol &symbol) const;
@@ -136,6 +224,38 @@ class Grammar {
     // const & to avoid copy when we already have a string...
     [[nodiscard]] Symbol const &findSymbol(std::string const &s) const;
 
+    // Warns about nonterminals which derive no terminal string or cannot be
+    // reached from the start symbols, and about productions using them.
+    // If `drop` is true, they are removed, and the remaining symbols and
+    // productions are renumbered. Must be called before calAttributes().
+    Grammar &reduce(bool drop);
+
+    // Shrinks the automata: a nonterminal used only once, at the end of a
+    // production, is replaced by its bodies and removed. If `factor` is true,
+    // alternatives with a common prefix are also left-factored with synthetic
+    // nonterminals, which an LL(1) table needs, but which add LR states.
+    // Productions and symbols are renumbered, and getOrigins() maps
+    // productions back. Must be called before calAttributes().
+    Grammar &transform(bool factor);
+    [[nodiscard]] bool isTransformed() const { return !origins.empty(); }
+    // Productions before transform(). Listeners receive their IDs.
+    [[nodiscard]] ProductionTable const &getOriginalProductions() const {
+        return isTransformed() ? originalProductions : productionTable;
+    }
+    // Symbols which listeners receive: those of getAllSymbols(), and then the
+    // nonterminals removed by transform().
+    [[nodiscard]] symvec_t const &getOriginalSymbols() const {
+        return originalSymbols.empty() ? symbols : originalSymbols;
+    }
+    // Original reductions which a reduction by `id` stands for, in order.
+    // It's empty if the production ends with a synthetic symbol: they are
+    // then given by the production which was reduced to that symbol. Only
+    // valid if isTransformed() is true.
+    [[nodiscard]] std::vector<OriginalReduction> const &
+    getOrigins(ProductionID id) const {
+        return origins[id];
+    }
+
     // Fill symbol attributes: nullable, firstSet, followSet
     Grammar &calAttributes();
 
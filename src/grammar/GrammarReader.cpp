@@ -4,6 +4,7 @@
 
 #include "src/grammar/GrammarReader.h"
 
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <stdexcept>
@@ -30,14 +31,14 @@ Grammar GrammarReader::parse(istream &stream) {
 
 void GrammarReader::parse(Grammar &g) try {
     std::string s;
-    bool startFound = false;
+    std::string firstHead;
 
-    while (getToken(s)) { // Has more rules
+    while (parseDirective(g) || getToken(s)) { // Has more rules
+        if (s.empty())
+            continue;
         auto nid = g.putSymbol(s.c_str(), false);
-        if (!startFound) {
-            g.setStart(s.c_str());
-            startFound = true;
-        }
+        if (firstHead.empty())
+            firstHead = s;
 
         // Default: "->"
         expectOrThrow(launchArgs.sep.c_str());
@@ -71,10 +72,16 @@ void GrammarReader::parse(Grammar &g) try {
             if (hasEpsilon) {
                 productionBody.clear(); // Epsilon rule
             }
-            g.addProduction(nid, std::move(productionBody));
+            auto prec = parsePrec(g);
+            g.addProduction(nid, std::move(productionBody), prec);
         } while (expect('|'));
+        s.clear();
     }
 
+    // Without "%start", the first non-terminal is the start symbol.
+    if (g.getStartSymbols().empty() && !firstHead.empty())
+        g.addStart(firstHead.c_str());
+
     // Check redundant input (which normally means invalid syntax)
     const char *e = nullptr;
     if (!token.empty())
@@ -85,6 +92,7 @@ void GrammarReader::parse(Grammar &g) try {
         throw std::runtime_error(std::string("Redunant input: ") + e);
 
     g.checkViolations();
+    g.resolvePrecedences();
 
 } catch (Grammar::UnsolvedSymbolError const &e) {
     std::string s = "Parsing error at line " +
@@ -117,8 +125,28 @@ auto GrammarReader::getLineAndCount(istream &is, std::string &s) -> bool {
     return false;
 }
 
+// Known directives. "%" followed by anything else starts a comment, so yacc
+// declarations like "%token" are still skipped.
+static const char *const directives[] = {"start", "left", "right",
+                                         "nonassoc", "prec"};
+
+// Returns the length of the directive name after "%", or 0.
+static size_t directiveAt(const char *p) {
+    if (*p != '%')
+        return 0;
+    for (auto name : directives) {
+        auto len = strlen(name);
+        if (strncmp(p + 1, name, len) == 0 &&
+            (!p[len + 1] || isspace(p[len + 1])))
+            return len;
+    }
+    return 0;
+}
+
 // static bool isCommentStart(char ch) { return ch == '!' || ch == '#' || ch == '%'; }
-static bool isCommentStart(char ch) { return ch == '%'; }
+static bool isCommentStart(const char *p) {
+    return *p == '%' && !directiveAt(p);
+}
 
 // Make sure *p is non-space
 // This is the only method to use `stream` directly, expect for
@@ -129,7 +157,7 @@ auto GrammarReader::skipSpaces(const char *p) -> const char * {
     while (true) {
         while (*p && isspace(*p))
             ++p;
-        if (*p && !isCommentStart(*p))
+        if (*p && !isCommentStart(p))
             return p;
         // A comment start ('!') mark is equal to end of line
         // End of line: we should refetch string
@@ -148,7 +176,7 @@ auto GrammarReader::skipBlanks(const char *p) -> const char * {
     // Do not fetch new line
     while (*p && isblank(*p))
         ++p;
-    if (isCommentStart(*p)) {
+    if (isCommentStart(p)) {
         while (*p)
             ++p;
     }
@@ -230,6 +258,11 @@ auto GrammarReader::getToken(std::string &s, bool newlineAutoFetch) -> bool {
     if (!p) {
         return false;
     }
+    // A directive ends the current rule.
+    if (directiveAt(p)) {
+        pos = p;
+        return false;
+    }
 
     if (launchArgs.strict) {
         // Check the first character
@@ -279,7 +312,7 @@ auto GrammarReader::getToken(std::string &s, bool newlineAutoFetch) -> bool {
         }
 
     } else {
-        while (*p && !isspace(*p) && *p != '|' && !isCommentStart(*p)) {
+        while (*p && !isspace(*p) && *p != '|' && *p != '%') {
             s += *p++;
         }
     }
@@ -296,6 +329,65 @@ auto GrammarReader::getToken(std::string &s, bool newlineAutoFetch) -> bool {
     return false;
 }
 
+// Directives:
+//   %start A B ...    Start symbols, the first one is the default.
+//   %left a b ...     Terminals of the next precedence level, which binds
+//   %right a b ...    tighter than the previous ones, and their
+//   %nonassoc a b ... associativity.
+auto GrammarReader::parseDirective(Grammar &g) -> bool {
+    if (!token.empty())
+        return false;
+    pos = skipSpaces(pos);
+    if (!pos)
+        return false;
+    auto len = directiveAt(pos);
+    if (!len)
+        return false;
+    std::string name(pos + 1, len);
+    pos += len + 1;
+
+    std::string s;
+    if (name == "start") {
+        bool found = false;
+        while (getToken(s, false)) {
+            g.addStart(s.c_str());
+            found = true;
+        }
+        if (!found)
+            throw std::runtime_error("%start needs at least one symbol");
+    } else if (name == "prec") {
+        throw std::runtime_error("%prec must follow the right side of a rule");
+    } else {
+        auto assoc = name == "left"    ? Associativity::LEFT
+                     : name == "right" ? Associativity::RIGHT
+                                       : Associativity::NONASSOC;
+        std::vector<SymbolID> terminals;
+        while (getToken(s, false))
+            terminals.push_back(g.putSymbol(s.c_str(), true));
+        if (terminals.empty())
+            throw std::runtime_error("%" + name +
+                                     " needs at least one terminal");
+        g.addPrecedenceLevel(assoc, terminals);
+    }
+    return true;
+}
+
+// Reads "%prec a" at the end of the right side of a rule, if there's one.
+// Returns the terminal, or -1.
+auto GrammarReader::parsePrec(Grammar &g) -> SymbolID {
+    if (!token.empty() || !pos)
+        return SymbolID{-1};
+    auto len = directiveAt(pos);
+    if (len != 4 || strncmp(pos + 1, "prec", len) != 0)
+        return SymbolID{-1};
+    pos += len + 1;
+
+    std::string s;
+    if (!getToken(s, false))
+        throw std::runtime_error("%prec needs a terminal");
+    return g.putSymbol(s.c_str(), true);
+}
+
 auto GrammarReader::ungetToken(const std::string &s) -> void {
     if (!token.empty()) {
         throw std::logic_error("Number of ungot tokens > 1");
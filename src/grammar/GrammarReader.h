@@ -39,6 +39,11 @@ class GrammarReader: public util::TokenReader {
     bool getToken(std::string &s) override;
     void ungetToken(const std::string &s);
     void parse(Grammar &g);
+    // Reads a directive like "%start" if there's one at the current position.
+    auto parseDirective(Grammar &g) -> bool;
+    // Reads "%prec a" after the right side of a rule. Returns -1 if there's
+    // none.
+    auto parsePrec(Grammar &g) -> SymbolID;
     auto nextEquals(char ch) -> bool;
     auto expect(char ch) -> bool;
     void expectOrThrow(const char *expected);
@@ -13,7 +13,9 @@ Grammar file:
   1) Use % to start a line comment.
   2) `epsilon` is reserved for epsilon. 
   3) | is reserved for separating multiple bodies of a production.
-  4) You shouldn't use token $ in grammar file.
+  4) You shouldn't use token $ in grammar file. `error` is a reserved terminal
+     for error recovery: when no action exists, the parser pops states until
+     one can shift `error`, and then discards tokens until it can go on.
   5) Define productions as the following example shows. All symbols at the left 
      hand side of productions are automatically defined as non-terminals. The 
      first non-terminal symbol is defined as the start symbol. While symbols in 
@@ -33,9 +35,21 @@ Grammar file:
      and '"' are okay, but you may not use them both in one symbol. Spaces in a 
      quoted string are not allowed. This mode can be turned on using argument
      `--strict`. In most cases, this mode is not necessary.
+  7) `%start A B ...` declares start symbols. They share one automaton and one
+     parse table, and each of them gets its own start state. The first one is
+     used unless --entry is given.
+  8) `%left a b ...`, `%right a b ...` and `%nonassoc a b ...` give terminals a
+     precedence level and an associativity. Each line binds tighter than the
+     ones above it. A production has the precedence of its last terminal, or
+     of `a` if its right side ends with `%prec a`. Shift/reduce conflicts
+     between them are settled like yacc does, so flat ambiguous grammars like
+     `E -> E + E | E * E | ID` can be used. Other lines starting with % are
+     comments.
 
 Options:
-  -t        : Choose a parser type. Available: lr0, slr (default), lalr, lr1. 
+  -t        : Choose a parser type. Available: lr0, slr (default), lalr, lr1,
+            ll1. ll1 builds a predictive table from the First and Follow sets
+            and needs no automata.
   -o        : Specify output directory. (Default: ".").
   -g        : Specify grammar file path. (Default: "grammar.txt")
   -h|--help : Output help message and then exit.
@@ -44,6 +58,11 @@ Flags:
 --no-test : Just generate automatons and parse table. Do not test an input 
             sequence. Program will finish as soon as the table is generated.
 --no-label: Only show index of each node in dumping results.
+--tree    : Print the concrete syntax tree after the test input is accepted.
+            With --glr, print the shared forest instead.
+--glr     : Test the input with a generalized LR driver, which forks on
+            conflicting table entries instead of stopping. Ambiguous inputs
+            are accepted, and their derivations are packed into a forest.
 --sep=str : Define the start of a production as the given <str>. The default 
             is "->", but you may want "::=" or ":" if your grammar is written 
             that way. This might be helpful if you are comparing several 
@@ -51,6 +70,24 @@ Flags:
 --strict  : This option applies to both the grammar and input sequence. See
             grammar introduction above.
 --debug   : Set output level to DEBUG. Not helpful if you are not developing.
+--quiet   : Do not print symbol tables, parse tables and parser states, nor
+            write the automata (NFA.gv, DFA.gv). Useful for large grammars
+            or inputs.
+--no-steps: Do not write the step trace (steps.py or steps.bin). The
+            tables are built faster, since no narration is generated.
+--binary-steps: Write the step trace in a compact binary format (steps.bin),
+            which is faster for large grammars. The GUI uses it, and
+            gui/StepTrace.py converts it to steps.py.
+--reduce  : Remove nonterminals which derive no terminal string or cannot be
+            reached from a start symbol, and the productions using them.
+            They are reported as warnings either way.
+--transform: Inline nonterminals which are used once at the end of a
+            production, so the automata have fewer states. With -tll1,
+            alternatives with a common prefix are also left-factored.
+            Reductions are still reported with the productions of the
+            grammar file. --glr does not support it.
+--entry=A : Parse the test input from start symbol A, which should be declared
+            by %start.
 --step    : Read <stdin> step by step. If you have to process a very large input
             file, you may need this flag. But without this flag the parser can 
             provide better display for input queue (by read all input into 
@@ -7,7 +7,9 @@
 
 #include "src/common.h"
 #include "src/grammar/Grammar.h"
+#include "src/parser/GLRParser.h"
 #include "src/parser/LALRParser.h"
+#include "src/parser/LLParser.h"
 #include "src/parser/LR0Parser.h"
 #include "src/parser/LR1Parser.h"
 #include "src/parser/LRParser.h"
@@ -33,10 +35,37 @@ void printUsageAndExit(bool onError = true) {
     exit(0);
 }
 
+// An LL(1) table needs no automata.
+void llMain(Grammar const &g) {
+    if (launchArgs.glr)
+        throw std::runtime_error("--glr needs an LR parser");
+    LLParser parser(g);
+    parser.buildParseTable();
+    parser.printSummary();
+    reportTime("Parse table built");
+
+    if (!launchArgs.entry.empty())
+        parser.setEntry(g.findSymbol(launchArgs.entry).id);
+
+    if (!launchArgs.noTest) {
+        bool accepted = parser.test(std::cin);
+        reportTime("Test finished");
+        if (accepted && launchArgs.dumpTree) {
+            display(SYNTAX_TREE, INFO, "Syntax tree", &parser.getSyntaxTree(),
+                    &g);
+        }
+    }
+}
+
 void lrMain() {
     Grammar g = Grammar::fromFile(launchArgs.grammarFileName.c_str());
     reportTime("Grammar rules read");
 
+    if (launchArgs.parserType == LL1) {
+        llMain(g);
+        return;
+    }
+
     // Choose a parser
     LRParser *parser = nullptr;
     ParserType t = launchArgs.parserType;
@@ -59,12 +88,44 @@ void lrMain() {
     
     step::section("Parse Table");
     parser->buildParseTable();
+    parser->printSummary();
     reportTime("Parse table built");
 
-    if (!launchArgs.noTest) {
+    if (!launchArgs.entry.empty())
+        parser->setEntry(g.findSymbol(launchArgs.entry).id);
+
+    if (!launchArgs.noTest && launchArgs.glr) {
+        display(LOG, INFO,
+                "Please input symbols for test (Use '$' to end the input)");
+        auto tokens = parser->tokenize(std::cin);
+        GLRParser glr(*parser);
+        bool accepted = glr.parse(tokens);
+        reportTime("Test finished");
+        util::Formatter f;
+        if (accepted) {
+            display(LOG, INFO,
+                    f.formatView("Input is accepted (%zu ambiguous node(s), "
+                                 "at most %zu stack(s))",
+                                 glr.getForest().countAmbiguities(),
+                                 glr.getMaxStacks())
+                        .data());
+            if (launchArgs.dumpTree)
+                display(SHARED_FOREST, INFO, "Shared forest", &glr);
+        } else {
+            display(LOG, ERR,
+                    f.formatView("No viable action for the token at "
+                                 "position %d",
+                                 glr.getErrorPosition())
+                        .data());
+        }
+    } else if (!launchArgs.noTest) {
         step::section("Test");
-        parser->test(std::cin);
+        bool accepted = parser->test(std::cin);
         reportTime("Test finished");
+        if (accepted && launchArgs.dumpTree) {
+            display(SYNTAX_TREE, INFO, "Syntax tree", &parser->getSyntaxTree(),
+                    &g);
+        }
     }
 
     delete parser;
@@ -79,6 +140,8 @@ void chooseParserType(const char *s) {
         launchArgs.parserType = LALR;
     } else if (strcmp("lr1", s) == 0) {
         launchArgs.parserType = LR1;
+    } else if (strcmp("ll1", s) == 0) {
+        launchArgs.parserType = LL1;
     } else {
         printUsageAndExit();
     }
@@ -119,6 +182,14 @@ void lrParseArgs(int argc, char **argv) {
             launchArgs.exhaustInput = false;
         } else if (strcmp("--no-test", argv[i]) == 0) {
             launchArgs.noTest = true;
+        } else if (strcmp("--no-steps", argv[i]) == 0) {
+            launchArgs.noSteps = true;
+        } else if (strcmp("--binary-steps", argv[i]) == 0) {
+            launchArgs.binarySteps = true;
+        } else if (strcmp("--reduce", argv[i]) == 0) {
+            launchArgs.reduce = true;
+        } else if (strcmp("--transform", argv[i]) == 0) {
+            launchArgs.transform = true;
         } else if (auto prefixlen = strlen("--sep="); 
                         strncmp("--sep=", argv[i], prefixlen) == 0) {
             launchArgs.sep = argv[i] + prefixlen;
@@ -138,6 +209,15 @@ void lrParseArgs(int argc, char **argv) {
             }
         } else if (strcmp("--no-label", argv[i]) == 0) {
             launchArgs.noPDALabel = true;
+        } else if (strcmp("--tree", argv[i]) == 0) {
+            launchArgs.dumpTree = true;
+        } else if (strcmp("--glr", argv[i]) == 0) {
+            launchArgs.glr = true;
+        } else if (strcmp("--quiet", argv[i]) == 0) {
+            launchArgs.quiet = true;
+        } else if (auto prefixlen = strlen("--entry=");
+                   strncmp("--entry=", argv[i], prefixlen) == 0) {
+            launchArgs.entry = argv[i] + prefixlen;
         } else {
             printUsageAndExit();
         }
@@ -0,0 +1,378 @@
+#include "src/parser/GLRParser.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+#include "src/util/Formatter.h"
+
+namespace gram {
+
+using ParseAction = LRParser::ParseAction;
+
+void SharedForest::addFamily(int node, ProductionID prodID, int const *kids,
+                             int n) {
+    int last = -1;
+    for (int f = nodes[node].firstFamily; f >= 0; f = families[f].nextFamily) {
+        auto const &family = families[f];
+        if (family.production == prodID && family.childCount == n &&
+            std::equal(kids, kids + n,
+                       children.begin() + family.childOffset)) {
+            return;
+        }
+        last = f;
+    }
+    auto offset = static_cast<int>(children.size());
+    children.insert(children.end(), kids, kids + n);
+    families.push_back(Family{prodID, offset, n, -1});
+    auto id = static_cast<int>(families.size()) - 1;
+    if (last < 0)
+        nodes[node].firstFamily = id;
+    else
+        families[last].nextFamily = id;
+}
+
+size_t SharedForest::countAmbiguities() const {
+    if (root < 0)
+        return 0;
+    size_t count = 0;
+    std::vector<bool> visited(nodes.size());
+    std::vector<int> stack{root};
+    visited[root] = true;
+    while (!stack.empty()) {
+        int node = stack.back();
+        stack.pop_back();
+        if (isAmbiguous(node))
+            ++count;
+        for (int f = nodes[node].firstFamily; f >= 0;
+             f = families[f].nextFamily) {
+            for (int i = 0; i < families[f].childCount; ++i) {
+                int child = children[families[f].childOffset + i];
+                if (!visited[child]) {
+                    visited[child] = true;
+                    stack.push_back(child);
+                }
+            }
+        }
+    }
+    return count;
+}
+
+std::string SharedForest::dumpString(Grammar const &g) const {
+    std::string s;
+    if (root < 0)
+        return s;
+    auto const &symbols = g.getAllSymbols();
+    util::Formatter f;
+    std::vector<bool> visited(nodes.size());
+    std::vector<int> stack{root};
+    visited[root] = true;
+    // Print nodes in pre-order. Shared nodes are printed once, and referred
+    // to by their IDs.
+    while (!stack.empty()) {
+        int node = stack.back();
+        stack.pop_back();
+        auto const &n = nodes[node];
+        if (n.firstFamily < 0)
+            continue;
+        s += f.formatView("n%d: %s [%d, %d)%s\n", node,
+                          symbols[n.symbol].name.c_str(), n.begin, n.end,
+                          isAmbiguous(node) ? " (ambiguous)" : "");
+        std::vector<int> next;
+        for (int fam = n.firstFamily; fam >= 0;
+             fam = families[fam].nextFamily) {
+            auto const &family = families[fam];
+            s += f.formatView("    r%d:", family.production);
+            if (family.childCount == 0)
+                s += ' ', s += Constants::epsilon;
+            for (int i = 0; i < family.childCount; ++i) {
+                int child = children[family.childOffset + i];
+                auto const &c = nodes[child];
+                if (c.firstFamily < 0) {
+                    s += ' ';
+                    s += symbols[c.symbol].name;
+                } else {
+                    s += f.formatView(" n%d", child);
+                }
+                if (!visited[child]) {
+                    visited[child] = true;
+                    next.push_back(child);
+                }
+            }
+            s += '\n';
+        }
+        stack.insert(stack.end(), next.rbegin(), next.rend());
+    }
+    return s;
+}
+
+GLRParser::GLRParser(LRParser const &lr) : lr(lr) {
+    if (lr.getGrammar().isTransformed())
+        throw std::runtime_error("GLR parsing does not support --transform");
+}
+
+int GLRParser::addGSSNode(StateID state, int level) {
+    gssNodes.push_back(GSSNode{state, level, -1});
+    return static_cast<int>(gssNodes.size()) - 1;
+}
+
+int GLRParser::addLink(int from, int to, int sppf) {
+    gssLinks.push_back(GSSLink{to, sppf, gssNodes[from].firstLink});
+    auto id = static_cast<int>(gssLinks.size()) - 1;
+    gssNodes[from].firstLink = id;
+    return id;
+}
+
+int GLRParser::findLink(int from, int to) const {
+    for (int l = gssNodes[from].firstLink; l >= 0; l = gssLinks[l].next) {
+        if (gssLinks[l].to == to)
+            return l;
+    }
+    return -1;
+}
+
+int GLRParser::forestNodeOf(SymbolID symbol, int begin, int end) {
+    if (!levelMapValid) {
+        // Deterministic steps cannot create the same node twice, so the map
+        // is only filled when the level forks.
+        int node = forest.addNode(symbol, begin, end);
+        levelForestList.push_back(node);
+        return node;
+    }
+    auto key = (static_cast<long long>(symbol) << 32) |
+               static_cast<unsigned>(begin);
+    auto result = levelForestNodes.try_emplace(key, -1);
+    if (result.second)
+        result.first->second = forest.addNode(symbol, begin, end);
+    return result.first->second;
+}
+
+StateID GLRParser::gotoOf(StateID state, SymbolID symbol) const {
+    for (auto const &pact : lr.getParseTable()[state][symbol]) {
+        if (pact.type == ParseAction::GOTO)
+            return pact.dest;
+    }
+    return StateID{-1};
+}
+
+bool GLRParser::fastReduce(int &top, ProductionID prodID, int level) {
+    auto const &prod = lr.getGrammar().getProductionTable()[prodID];
+    auto n = static_cast<int>(prod.rightSymbols.size());
+    pathKids.resize(n);
+    int node = top;
+    for (int k = n - 1; k >= 0; --k) {
+        int l = gssNodes[node].firstLink;
+        if (l < 0 || gssLinks[l].next >= 0)
+            return false;
+        pathKids[k] = gssLinks[l].sppf;
+        node = gssLinks[l].to;
+    }
+    StateID next = gotoOf(gssNodes[node].state, prod.leftSymbol);
+    if (next < 0)
+        return false;
+    int sppf = forestNodeOf(prod.leftSymbol, gssNodes[node].level, level);
+    forest.addFamily(sppf, prodID, pathKids.data(), n);
+    int w = addGSSNode(next, level);
+    addLink(w, node, sppf);
+    top = w;
+    return true;
+}
+
+void GLRParser::enqueueReductions(int node, SymbolID lookahead,
+                                  int requiredLink) {
+    auto const &productionTable = lr.getGrammar().getProductionTable();
+    auto const &cell = lr.getParseTable()[gssNodes[node].state][lookahead];
+    for (auto const &pact : cell) {
+        if (pact.type != ParseAction::REDUCE)
+            continue;
+        // Empty reductions do not go through any link.
+        if (requiredLink >= 0 &&
+            productionTable[pact.productionID].rightSymbols.empty())
+            continue;
+        reductions.push_back(Reduction{node, pact.productionID, requiredLink});
+    }
+}
+
+void GLRParser::reducer(int from, ProductionID prodID, int level,
+                        int const *kids, int n) {
+    auto head = lr.getGrammar().getProductionTable()[prodID].leftSymbol;
+    StateID next = gotoOf(gssNodes[from].state, head);
+    if (next < 0)
+        return;
+    int sppf = forestNodeOf(head, gssNodes[from].level, level);
+    forest.addFamily(sppf, prodID, kids, n);
+
+    int w = stateToNode[next];
+    if (w < 0) {
+        w = addGSSNode(next, level);
+        stateToNode[next] = w;
+        frontier.push_back(w);
+        addLink(w, from, sppf);
+        enqueueReductions(w, currentLookahead, -1);
+        return;
+    }
+    // Merge stacks. If the link exists, the derivation has been packed into
+    // its forest node above.
+    if (findLink(w, from) >= 0)
+        return;
+    int link = addLink(w, from, sppf);
+    // Paths through the new link have not been reduced yet.
+    for (size_t i = 0; i < frontier.size(); ++i) {
+        enqueueReductions(frontier[i], currentLookahead, link);
+    }
+}
+
+void GLRParser::reducePaths(Reduction const &r, int level) {
+    auto const &prod = lr.getGrammar().getProductionTable()[r.production];
+    auto n = static_cast<int>(prod.rightSymbols.size());
+    if (n == 0) {
+        reducer(r.node, r.production, level, nullptr, 0);
+        return;
+    }
+    // Kids are copied into the forest by reducer(), so the buffer can be
+    // shared by nested calls.
+    std::vector<int> kids(n);
+    auto walk = [&](auto &self, int node, int remaining, bool used) -> void {
+        if (remaining == 0) {
+            if (r.requiredLink < 0 || used)
+                reducer(node, r.production, level, kids.data(), n);
+            return;
+        }
+        for (int l = gssNodes[node].firstLink; l >= 0; l = gssLinks[l].next) {
+            kids[remaining - 1] = gssLinks[l].sppf;
+            self(self, gssLinks[l].to, remaining - 1,
+                 used || l == r.requiredLink);
+        }
+    };
+    walk(walk, r.node, n, false);
+}
+
+bool GLRParser::reduceAll(int level, SymbolID lookahead) {
+    auto const &table = lr.getParseTable();
+    currentLookahead = lookahead;
+
+    if (!levelMapValid) {
+        for (int node : levelForestList) {
+            auto const &n = forest.getNodes()[node];
+            auto key = (static_cast<long long>(n.symbol) << 32) |
+                       static_cast<unsigned>(n.begin);
+            levelForestNodes.emplace(key, node);
+        }
+        levelMapValid = true;
+    }
+
+    reductions.clear();
+    for (int v : frontier)
+        stateToNode[gssNodes[v].state] = v;
+    for (size_t i = 0, sz = frontier.size(); i < sz; ++i)
+        enqueueReductions(frontier[i], lookahead, -1);
+    while (!reductions.empty()) {
+        auto r = reductions.back();
+        reductions.pop_back();
+        reducePaths(r, level);
+    }
+    maxStacks = std::max(maxStacks, frontier.size());
+
+    bool accepted = false;
+    for (int v : frontier) {
+        stateToNode[gssNodes[v].state] = -1;
+        for (auto const &pact : table[gssNodes[v].state][lookahead]) {
+            if (pact.type == ParseAction::SUCCESS && !accepted) {
+                accepted = true;
+                forest.root = gssLinks[gssNodes[v].firstLink].sppf;
+            }
+        }
+    }
+    if (accepted)
+        return true;
+
+    // Shift. Tops of the next level are merged by state.
+    int leaf = -1;
+    std::vector<int> next;
+    for (int v : frontier) {
+        for (auto const &pact : table[gssNodes[v].state][lookahead]) {
+            if (pact.type != ParseAction::SHIFT)
+                continue;
+            if (leaf < 0)
+                leaf = forest.addNode(lookahead, level, level + 1);
+            int w = stateToNode[pact.dest];
+            if (w < 0) {
+                w = addGSSNode(pact.dest, level + 1);
+                stateToNode[pact.dest] = w;
+                next.push_back(w);
+            }
+            addLink(w, v, leaf);
+        }
+    }
+    for (int w : next)
+        stateToNode[gssNodes[w].state] = -1;
+    frontier = std::move(next);
+    return false;
+}
+
+bool GLRParser::parse(std::vector<SymbolID> const &tokens) {
+    auto const &table = lr.getParseTable();
+    forest.clear();
+    gssNodes.clear();
+    gssLinks.clear();
+    frontier.clear();
+    reductions.clear();
+    stateToNode.assign(table.size(), -1);
+    errorPosition = -1;
+    maxStacks = 1;
+    forkedSteps = 0;
+
+    frontier.push_back(addGSSNode(lr.getStartState(), 0));
+    auto n = static_cast<int>(tokens.size());
+
+    for (int level = 0; level < n; ++level) {
+        auto lookahead = tokens[level];
+        levelForestNodes.clear();
+        levelForestList.clear();
+        levelMapValid = false;
+
+        // Deterministic steps, the same as the plain LR driver.
+        if (frontier.size() == 1) {
+            int top = frontier.front();
+            bool shifted = false;
+            while (true) {
+                auto const &cell = table[gssNodes[top].state][lookahead];
+                if (cell.size() != 1)
+                    break;
+                auto const &pact = *cell.begin();
+                if (pact.type == ParseAction::REDUCE) {
+                    if (fastReduce(top, pact.productionID, level))
+                        continue;
+                } else if (pact.type == ParseAction::SHIFT) {
+                    int leaf = forest.addNode(lookahead, level, level + 1);
+                    int w = addGSSNode(pact.dest, level + 1);
+                    addLink(w, top, leaf);
+                    frontier.assign(1, w);
+                    shifted = true;
+                } else if (pact.type == ParseAction::SUCCESS) {
+                    forest.root = gssLinks[gssNodes[top].firstLink].sppf;
+                    return true;
+                }
+                break;
+            }
+            if (shifted)
+                continue;
+            frontier.assign(1, top);
+        }
+
+        ++forkedSteps;
+        if (reduceAll(level, lookahead))
+            return true;
+        if (frontier.empty()) {
+            errorPosition = level;
+            return false;
+        }
+    }
+    errorPosition = n;
+    return false;
+}
+
+} // namespace gram
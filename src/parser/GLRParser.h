@@ -0,0 +1,156 @@
+#ifndef LRPARSER_GLR_H
+#define LRPARSER_GLR_H
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "src/common.h"
+#include "src/parser/LRParser.h"
+
+namespace gram {
+
+// A shared packed parse forest. Every node is identified by (symbol, token
+// span). Interior nodes have one or more families (alternative derivations),
+// so an ambiguous input has nodes with several families instead of several
+// trees.
+class SharedForest {
+  public:
+    struct Node {
+        SymbolID symbol;
+        int begin;
+        int end;
+        int firstFamily; // -1 for tokens
+    };
+    struct Family {
+        ProductionID production;
+        int childOffset; // Into `children`
+        int childCount;
+        int nextFamily;
+    };
+
+    [[nodiscard]] auto const &getNodes() const { return nodes; }
+    [[nodiscard]] auto const &getFamilies() const { return families; }
+    [[nodiscard]] auto const &getChildren() const { return children; }
+    [[nodiscard]] int getRoot() const { return root; }
+    [[nodiscard]] bool isAmbiguous(int node) const {
+        int f = nodes[node].firstFamily;
+        return f >= 0 && families[f].nextFamily >= 0;
+    }
+
+    // Number of nodes reachable from the root with more than one family.
+    [[nodiscard]] size_t countAmbiguities() const;
+
+    // One line per reachable node, followed by its families.
+    [[nodiscard]] std::string dumpString(Grammar const &g) const;
+
+  private:
+    friend class GLRParser;
+    std::vector<Node> nodes;
+    std::vector<Family> families;
+    std::vector<int> children;
+    int root = -1;
+
+    void clear() {
+        nodes.clear();
+        families.clear();
+        children.clear();
+        root = -1;
+    }
+
+    int addNode(SymbolID symbol, int begin, int end) {
+        nodes.push_back(Node{symbol, begin, end, -1});
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    // Adds a family unless an identical one exists.
+    void addFamily(int node, ProductionID prodID, int const *kids, int n);
+};
+
+// Generalized LR driver. It runs on the parse table of a built LRParser, and
+// forks wherever a table cell holds more than one action. Stacks are kept in a
+// graph-structured stack (GSS): stacks share their prefixes, and stacks that
+// reach the same state at the same position are merged into one node.
+//
+// While only one stack is alive and table cells have a single action, the
+// driver works like the plain LR driver on a single top node.
+class GLRParser {
+  public:
+    // The forest is built from the productions of the table, so the grammar
+    // must not be transformed.
+    explicit GLRParser(LRParser const &lr);
+
+    // `tokens` should end with "$". Returns true if the input is accepted.
+    bool parse(std::vector<SymbolID> const &tokens);
+
+    [[nodiscard]] SharedForest const &getForest() const { return forest; }
+    [[nodiscard]] LRParser const &getLRParser() const { return lr; }
+    // Position of the token where all stacks died. -1 if there's no error.
+    [[nodiscard]] int getErrorPosition() const { return errorPosition; }
+    // Largest number of simultaneously alive stack tops.
+    [[nodiscard]] size_t getMaxStacks() const { return maxStacks; }
+    // Number of tokens processed with more than one stack or action.
+    [[nodiscard]] size_t getForkedSteps() const { return forkedSteps; }
+
+  private:
+    struct GSSNode {
+        StateID state;
+        int level;
+        int firstLink;
+    };
+    struct GSSLink {
+        int to;
+        int sppf;
+        int next;
+    };
+    // A pending reduction. If `requiredLink` >= 0, only paths through that
+    // link are reduced (the others have been reduced before it was added).
+    struct Reduction {
+        int node;
+        ProductionID production;
+        int requiredLink;
+    };
+
+    LRParser const &lr;
+    SharedForest forest;
+    std::vector<GSSNode> gssNodes;
+    std::vector<GSSLink> gssLinks;
+    // Alive tops at the current level, and the top of each state (or -1).
+    std::vector<int> frontier;
+    std::vector<int> stateToNode;
+    std::vector<Reduction> reductions;
+    SymbolID currentLookahead{-1};
+    // Forest nodes of the current level, keyed by (symbol, begin).
+    std::unordered_map<long long, int> levelForestNodes;
+    std::vector<int> levelForestList;
+    bool levelMapValid = false;
+    // Scratch buffers for path enumeration.
+    std::vector<int> pathKids;
+    int errorPosition = -1;
+    size_t maxStacks = 0;
+    size_t forkedSteps = 0;
+
+    int addGSSNode(StateID state, int level);
+    int addLink(int from, int to, int sppf);
+    int findLink(int from, int to) const;
+
+    int forestNodeOf(SymbolID symbol, int begin, int end);
+    StateID gotoOf(StateID state, SymbolID symbol) const;
+
+    // Deterministic step for a single top. Returns false if the cell is not
+    // a single action, or the reduction path is shared.
+    bool fastReduce(int &top, ProductionID prodID, int level);
+
+    // Processes all reductions with lookahead tokens[level], and shifts to
+    // the tops of the next level. Returns true if the input is accepted.
+    bool reduceAll(int level, SymbolID lookahead);
+    void reducePaths(Reduction const &r, int level);
+    void reducer(int from, ProductionID prodID, int level, int const *kids,
+                 int n);
+    void enqueueReductions(int node, SymbolID lookahead, int requiredLink);
+};
+
+} // namespace gram
+
+#endif
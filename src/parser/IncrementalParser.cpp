@@ -0,0 +1,338 @@
+#include "src/parser/IncrementalParser.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+
+namespace gram {
+
+using ParseAction = LRParser::ParseAction;
+using NodeID = SyntaxTree::NodeID;
+
+namespace {
+
+// Makes v[begin, end) `count` elements long, moving the elements after it at
+// most once.
+template <class T>
+void resizeRange(std::vector<T> &v, size_t begin, size_t end, size_t count) {
+    auto at = v.begin() + static_cast<std::ptrdiff_t>(begin);
+    auto size = end - begin;
+    if (count < size) {
+        v.erase(at + static_cast<std::ptrdiff_t>(count),
+                at + static_cast<std::ptrdiff_t>(size));
+    } else if (count > size) {
+        v.insert(at + static_cast<std::ptrdiff_t>(size), count - size, T{});
+    }
+}
+
+} // namespace
+
+IncrementalParser::IncrementalParser(LRParser const &lr) : lr(lr) {
+    if (lr.getGrammar().isTransformed()) {
+        throw std::runtime_error(
+            "Incremental parsing does not support --transform");
+    }
+}
+
+bool IncrementalParser::parse(std::vector<SymbolID> input) {
+    tokens = std::move(input);
+    if (tokens.empty() ||
+        tokens.back() != lr.getGrammar().getEndOfInputSymbol().id) {
+        throw std::runtime_error("Input of the parser should end with $");
+    }
+    leaves.assign(tokens.size(), SyntaxTree::none);
+    reusedNodes = reusedTokens = shiftedTokens = 0;
+    valid = run(Damage{});
+    liveNodes = tree.size();
+    return valid;
+}
+
+bool IncrementalParser::edit(size_t begin, size_t end,
+                             std::vector<SymbolID> const &replacement) {
+    // The last token is "$".
+    if (begin > end || end >= tokens.size()) {
+        throw std::runtime_error("Edit range is out of the input");
+    }
+    auto const &g = lr.getGrammar();
+    for (auto token : replacement) {
+        if (g.getAllSymbols()[token].type != SymbolType::TERM ||
+            token == g.getEndOfInputSymbol().id) {
+            throw std::runtime_error("Edit can only insert terminals");
+        }
+    }
+    resizeRange(tokens, begin, end, replacement.size());
+    std::copy(replacement.begin(), replacement.end(),
+              tokens.begin() + static_cast<std::ptrdiff_t>(begin));
+    resizeRange(leaves, begin, end, replacement.size());
+    std::fill_n(leaves.begin() + static_cast<std::ptrdiff_t>(begin),
+                replacement.size(), SyntaxTree::none);
+
+    // Old nodes are never freed, so start over once the garbage outgrows the
+    // live tree. This keeps the memory bounded, and costs O(1) per node
+    // created by edits.
+    Damage damage{begin, end, replacement.size(), false};
+    if (!valid || tree.size() > 2 * liveNodes + 1024)
+        damage.all = true;
+    reusedNodes = reusedTokens = shiftedTokens = 0;
+    valid = (!damage.all && splice(damage)) || run(damage);
+    if (damage.all)
+        liveNodes = tree.size();
+    return valid;
+}
+
+StateID IncrementalParser::destOf(StateID state, SymbolID symbol) const {
+    for (auto const &pact : lr.getParseTable()[state][symbol]) {
+        if (pact.type == ParseAction::SHIFT || pact.type == ParseAction::GOTO)
+            return pact.dest;
+    }
+    return StateID{-1};
+}
+
+NodeID IncrementalParser::successorOf(NodeID node, NodeID root) const {
+    while (node != root && tree.nextSiblingOf(node) == SyntaxTree::none)
+        node = tree.parentOf(node);
+    return node == root ? SyntaxTree::none : tree.nextSiblingOf(node);
+}
+
+void IncrementalParser::breakDown(NodeID &node, NodeID root) const {
+    auto child = tree.firstChildOf(node);
+    node = child != SyntaxTree::none ? child : successorOf(node, root);
+}
+
+bool IncrementalParser::reduce(ProductionID prodID) {
+    auto const &prod = lr.getGrammar().getProductionTable()[prodID];
+    auto bodySize = prod.rightSymbols.size();
+    if (stack.size() <= bodySize)
+        return false;
+    auto first = stack.size() - bodySize;
+    kids.clear();
+    for (size_t i = first; i < stack.size(); ++i) {
+        auto kid = stack[i].node;
+        if (kid < firstNewNode) {
+            savedLinks.push_back(
+                SavedLinks{kid, tree.parentOf(kid), tree.nextSiblingOf(kid)});
+        }
+        kids.push_back(kid);
+    }
+    stack.resize(first);
+
+    auto below = stack.back().state;
+    auto node = tree.addNode(prod.leftSymbol, prodID, kids.data(), bodySize);
+    tree.setState(node, below);
+    auto dest = destOf(below, prod.leftSymbol);
+    if (dest < 0) {
+        throw std::runtime_error(
+            "No viable action in parse table for this input");
+    }
+    stack.push_back(Entry{dest, node});
+    return true;
+}
+
+bool IncrementalParser::run(Damage const &damage) try {
+    NodeID oldRoot = SyntaxTree::none;
+    if (damage.all)
+        tree.clear();
+    else
+        oldRoot = tree.getRoot();
+    tree.setRoot(SyntaxTree::none);
+
+    Scope scope{oldRoot, 0, tokens.size(), lr.getStartState(), SymbolID{-1},
+                true};
+    switch (drive(damage, scope)) {
+    case ACCEPTED:
+        return true;
+    case REJECTED:
+        return false;
+    default:
+        throw std::runtime_error("Stack's states are not enough for reduction");
+    }
+} catch (std::runtime_error const &e) {
+    display(LOG, ERR, e.what());
+    return false;
+}
+
+bool IncrementalParser::splice(Damage const &damage) {
+    // The node must start before the edit, so that the state below it does
+    // not change.
+    if (damage.begin == 0)
+        return false;
+    auto node = leaves[damage.begin - 1];
+    size_t begin = damage.begin - 1;
+    for (int tries = 0; tries < maxSpliceTries;) {
+        auto width = static_cast<size_t>(tree.widthOf(node));
+        if (!tree.isLeaf(node) && begin + width >= damage.end) {
+            ++tries;
+            Scope scope{node,
+                        begin,
+                        begin + width + damage.inserted -
+                            (damage.end - damage.begin),
+                        tree.stateOf(node),
+                        tree.symbolOf(node),
+                        false};
+            firstNewNode = static_cast<NodeID>(tree.size());
+            Outcome outcome = REJECTED;
+            try {
+                outcome = drive(damage, scope);
+            } catch (std::runtime_error const &) {
+                // Reported again by run().
+            }
+            firstNewNode = SyntaxTree::none;
+            if (outcome == REDUCED) {
+                savedLinks.clear();
+                savedLeaves.clear();
+                tree.replace(node, stack.back().node);
+                return true;
+            }
+            for (auto it = savedLinks.rbegin(); it != savedLinks.rend(); ++it)
+                tree.setLinks(it->node, it->parent, it->nextSibling);
+            for (auto it = savedLeaves.rbegin(); it != savedLeaves.rend(); ++it)
+                leaves[it->first] = it->second;
+            savedLinks.clear();
+            savedLeaves.clear();
+            // A syntax error would also be one in a larger node.
+            if (outcome != ESCAPED)
+                return false;
+        }
+        auto parent = tree.parentOf(node);
+        if (parent == SyntaxTree::none)
+            return false;
+        for (auto child = tree.firstChildOf(parent); child != node;
+             child = tree.nextSiblingOf(child)) {
+            begin -= static_cast<size_t>(tree.widthOf(child));
+        }
+        node = parent;
+    }
+    return false;
+}
+
+IncrementalParser::Outcome IncrementalParser::drive(Damage const &damage,
+                                                    Scope const &scope) {
+    auto const &table = lr.getParseTable();
+
+    // Maps a position in the new tokens to the old tokens. Returns false for
+    // inserted tokens.
+    auto oldPositionOf = [&damage](size_t pos, size_t &old) {
+        if (pos < damage.begin) {
+            old = pos;
+            return true;
+        }
+        if (pos >= damage.begin + damage.inserted) {
+            old = pos - damage.begin - damage.inserted + damage.end;
+            return true;
+        }
+        return false;
+    };
+    auto reusable = [this, &damage](NodeID node, size_t begin) {
+        auto end = begin + tree.widthOf(node);
+        return tree.stateOf(node) >= 0 &&
+               (end < damage.begin || begin >= damage.end);
+    };
+
+    stack.clear();
+    stack.push_back(Entry{scope.base, SyntaxTree::none});
+    // The candidate is the largest old node which has not been taken apart,
+    // starting at old position `candBegin`.
+    NodeID cand = scope.root;
+    size_t candBegin = scope.begin;
+    size_t pos = scope.begin;
+
+    while (true) {
+        if (!scope.whole && pos == scope.end && stack.size() == 2 &&
+            tree.symbolOf(stack.back().node) == scope.symbol) {
+            return REDUCED;
+        }
+        auto top = stack.back().state;
+        size_t old = 0;
+        bool atCand = false;
+        if (cand != SyntaxTree::none && oldPositionOf(pos, old)) {
+            // Skip old nodes to the left of the current position.
+            while (cand != SyntaxTree::none && candBegin < old) {
+                auto width = static_cast<size_t>(tree.widthOf(cand));
+                if (candBegin + width <= old) {
+                    candBegin += width;
+                    cand = successorOf(cand, scope.root);
+                } else {
+                    cand = tree.firstChildOf(cand);
+                }
+            }
+            // Nodes overlapping the edit are never reused, so take them
+            // apart for good.
+            while (cand != SyntaxTree::none && candBegin == old &&
+                   !tree.isLeaf(cand) && !reusable(cand, candBegin)) {
+                breakDown(cand, scope.root);
+            }
+            atCand = cand != SyntaxTree::none && candBegin == old;
+        }
+
+        // The current state may fit a node on the left spine of the candidate
+        // rather than the candidate itself.
+        auto spine = atCand && reusable(cand, candBegin) ? cand
+                                                         : SyntaxTree::none;
+        for (; spine != SyntaxTree::none; spine = tree.firstChildOf(spine)) {
+            if (tree.stateOf(spine) == top)
+                break;
+        }
+        if (spine != SyntaxTree::none) {
+            auto dest = destOf(top, tree.symbolOf(spine));
+            if (dest >= 0) {
+                auto width = static_cast<size_t>(tree.widthOf(spine));
+                auto next = successorOf(spine, scope.root);
+                stack.push_back(Entry{dest, spine});
+                ++reusedNodes;
+                reusedTokens += width;
+                pos += width;
+                candBegin += width;
+                cand = next;
+                continue;
+            }
+        }
+
+        auto const &cell = table[top][tokens[pos]];
+        if (cell.empty())
+            return REJECTED;
+        if (cell.size() > 1) {
+            throw std::runtime_error(
+                "Multiple viable choices. Cannot decide which action "
+                "to take");
+        }
+        auto const &decision = *cell.begin();
+        switch (decision.type) {
+        case ParseAction::GOTO:
+            throw std::logic_error("Goto item should be processed by reduce()");
+        case ParseAction::REDUCE:
+            if (!reduce(decision.productionID))
+                return ESCAPED;
+            break;
+        case ParseAction::SHIFT: {
+            if (pos == scope.end)
+                return ESCAPED;
+            // No node starting here fits the current state, and the state
+            // does not change until the token is shifted.
+            while (atCand && cand != SyntaxTree::none && candBegin == old &&
+                   !tree.isLeaf(cand)) {
+                breakDown(cand, scope.root);
+            }
+            auto leaf = tree.addLeaf(tokens[pos]);
+            tree.setState(leaf, top);
+            if (firstNewNode != SyntaxTree::none)
+                savedLeaves.emplace_back(pos, leaves[pos]);
+            leaves[pos] = leaf;
+            stack.push_back(Entry{decision.dest, leaf});
+            ++pos;
+            ++shiftedTokens;
+            break;
+        }
+        case ParseAction::SUCCESS:
+            if (!scope.whole)
+                return ESCAPED;
+            tree.setRoot(stack.back().node);
+            return ACCEPTED;
+        }
+    }
+}
+
+} // namespace gram
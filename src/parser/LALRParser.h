@@ -8,122 +8,140 @@
 #include "src/util/BitSet.h"
 #include "src/util/Formatter.h"
 #include "src/display/steps.h"
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <optional>
 #include <queue>
 #include <stack>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace gram {
 class LALRParser : public LRParser {
   private:
-    using LALRClosure = std::map<StateID, Constraint>;
+    // An item of a LALR closure: a LR(0) state and its lookaheads.
+    struct LALRItem {
+        StateID state;
+        Constraint constraint;
+    };
+    // Items of a closure, sorted by state.
+    using LALRClosure = std::vector<LALRItem>;
+
+    // Index of each LR(0) state in the closure being built, or -1. It's
+    // reset after every use.
+    std::vector<int> itemIndex;
 
     void makeClosure(std::vector<State> const &lr0States,
                      LALRClosure &lalrClosure) {
-        ActionID epsilonID = gram.getEpsilonSymbol().id;
-        std::stack<decltype(lalrClosure.begin())> stack;
-        for (auto it = lalrClosure.begin(); it != lalrClosure.end(); ++it) {
-            stack.push(it);
+        std::stack<int> stack;
+        for (int i = 0; i < static_cast<int>(lalrClosure.size()); ++i) {
+            itemIndex[lalrClosure[i].state] = i;
+            stack.push(i);
         }
         while (!stack.empty()) {
-            auto lalrStateIter = stack.top();
+            auto lalrStateIndex = stack.top();
             stack.pop();
-            auto const &lr0State = lr0States[lalrStateIter->first];
-            auto const &trans = *lr0State.transitions;
-            auto range = trans.rangeOf(epsilonID);
-            for (auto it = range.first; it != range.second; ++it) {
-                auto iter = lalrClosure.find(it->destination);
-                if (iter == lalrClosure.end()) {
+            auto lr0StateID = lalrClosure[lalrStateIndex].state;
+            auto const &lr0State = lr0States[lr0StateID];
+            auto epsilons = nfa.epsilonTransitionsOf(lr0StateID);
+            if (epsilons.empty())
+                continue;
+            // All items reached by epsilon edges get the same lookaheads.
+            auto constraint = resolveConstraintsPrivate(
+                &lalrClosure[lalrStateIndex].constraint,
+                lr0State.productionID, lr0State.rhsIndex);
+            for (auto dest : epsilons) {
+                auto index = itemIndex[dest];
+                if (index < 0) {
                     // State's not in closure. Should add it to closure.
-                    auto result = lalrClosure.emplace(
-                        it->destination,
-                        resolveConstraintsPrivate(&lalrStateIter->second,
-                                                  lr0State.productionID,
-                                                  lr0State.rhsIndex));
-                    stack.push(result.first);
+                    itemIndex[dest] = static_cast<int>(lalrClosure.size());
+                    stack.push(itemIndex[dest]);
+                    lalrClosure.push_back({dest, constraint});
                 } else {
                     // Update constraint.
-                    iter->second |= resolveConstraintsPrivate(
-                        &lalrStateIter->second, lr0State.productionID,
-                        lr0State.rhsIndex);
+                    lalrClosure[index].constraint |= constraint;
                 }
             }
         }
+        for (auto const &item : lalrClosure)
+            itemIndex[item.state] = -1;
+        sortItems(lalrClosure);
     }
 
     // actionID cannot be epsilonID
-    std::map<StateID, Constraint> transit(std::vector<State> const &lr0States,
-                                          ActionID actionID,
-                                          LALRClosure const &lalrClosure) {
-        std::map<StateID, Constraint> result;
+    LALRClosure transit(std::vector<State> const &lr0States,
+                        ActionID actionID, LALRClosure const &lalrClosure) {
+        LALRClosure result;
 
         for (auto const &[lr0StateID, constraint] : lalrClosure) {
-            auto const &lr0State = lr0States[lr0StateID];
-            auto const &trans = *lr0State.transitions;
-            auto range = trans.rangeOf(actionID);
-            for (auto it = range.first; it != range.second; ++it) {
-                auto iter = result.find(it->destination);
-                if (iter == result.end()) {
-                    result.emplace(it->destination, constraint);
+            for (auto const &tran : nfa.transitionsOf(lr0StateID, actionID)) {
+                auto index = itemIndex[tran.destination];
+                if (index < 0) {
+                    itemIndex[tran.destination] =
+                        static_cast<int>(result.size());
+                    result.push_back({tran.destination, constraint});
                 } else {
                     // Must merge
-                    iter->second |= constraint;
+                    result[index].constraint |= constraint;
                 }
             }
         }
+        for (auto const &item : result)
+            itemIndex[item.state] = -1;
 
+        sortItems(result);
         makeClosure(lr0States, result);
         return result;
     }
 
+    static void sortItems(LALRClosure &lalrClosure) {
+        std::sort(lalrClosure.begin(), lalrClosure.end(),
+                  [](LALRItem const &a, LALRItem const &b) {
+                      return a.state < b.state;
+                  });
+    }
+
     // Real constraint resolving method.
     [[nodiscard]] Constraint
     resolveConstraintsPrivate(const Constraint *parentConstraint,
                               ProductionID prodID, int rhsIndex) {
-        auto const &symbols = gram.getAllSymbols();
-        Constraint constraint(symbols.size());
-
         // Handle "S' -> S" carefully.
-        auto const &productionTable = gram.getProductionTable();
-        if (prodID == productionTable.size()) {
+        if (prodID >= (int)gram.getProductionTable().size()) {
+            Constraint constraint(gram.getAllSymbols().size());
             constraint.insert(gram.getEndOfInputSymbol().id);
             return constraint;
         }
 
-        auto const &rhs = productionTable[prodID].rightSymbols;
-
-        bool allNullable = true;
-        for (size_t i = rhsIndex + 1; allNullable && i < rhs.size(); ++i) {
-            if (!symbols[rhs[i]].nullable)
-                allNullable = false;
-            constraint |= symbols[rhs[i]].firstSet;
-        }
-        if (allNullable && parentConstraint)
+        Constraint constraint(gram.suffixFirstSet(prodID, rhsIndex + 1));
+        if (parentConstraint && gram.suffixNullable(prodID, rhsIndex + 1))
             constraint |= *parentConstraint;
-
         return constraint;
     }
 
-    // Ignore constraints and only compare kernels
-    struct ClosureKernelCmp {
-        bool operator()(LALRClosure const &m1, LALRClosure const &m2) const {
-            auto i1 = m1.begin(), i2 = m2.begin(), e1 = m1.end(), e2 = m2.end();
-            for (; (i1 != e1) && (i2 != e2); (void)++i1, (void)++i2) {
-                if (i1->first != i2->first)
-                    return i1->first < i2->first;
-            }
-            return i1 == e1 && i2 != e2;
-        };
-    };
+    // Closures are identified by their states, and constraints are ignored.
+    static size_t kernelHash(LALRClosure const &lalrClosure) {
+        size_t res = 17;
+        for (auto const &item : lalrClosure)
+            res = res * 31 + std::hash<StateID>()(item.state);
+        return res;
+    }
+
+    static bool sameKernel(LALRClosure const &c1, LALRClosure const &c2) {
+        return std::equal(c1.begin(), c1.end(), c2.begin(), c2.end(),
+                          [](LALRItem const &a, LALRItem const &b) {
+                              return a.state == b.state;
+                          });
+    }
 
   public:
     explicit LALRParser(Grammar const &g) : LRParser(g) {}
 
     // We have buildNFA() in base class build a LR0 NFA automaton for us.
     void buildDFA() override {
+        util::BlockArena::Scope arenaScope(blockArena);
         PushDownAutomaton &M = dfa;
         auto const &lr0States = nfa.getAllStates();
         auto const epsilonID = nfa.epsilonAction;
@@ -134,29 +152,51 @@ class LALRParser : public LRParser {
         M.setEpsilonAction(nfa.epsilonAction);
         M.setEndOfInputAction(nfa.endOfInputAction);
 
-        // <LALRClosure, ClosureID>
-        std::map<LALRClosure, int, ClosureKernelCmp> closureIndexMap;
-        // Stores iterators of unvisited closureIndexMap.
+        // Indexed by closure ID.
+        std::vector<LALRClosure> lalrClosures;
+        // <kernelHash, ClosureID>
+        std::unordered_multimap<size_t, int> closureIndexMap;
+        // Stores IDs of unvisited closures.
         // Stack should be the same as queue. but queue is easier to debug.
-        std::queue<decltype(closureIndexMap.cbegin())> queue;
-
-        // Prepare the first closure
-        auto const &startState = lr0States.front();
-        LALRClosure startClosure;
-        auto s0 = M.addPseudoState();
-        M.markStartState(s0);
-        startClosure.emplace(s0, *startState.constraint);
-        makeClosure(lr0States, startClosure);
-
-        step::addState(s0, std::string{kernelLabelMap.back().front()} + ", $");
-        step::setStart(s0);
-        step::show("Add start state.");
-        util::Formatter f;
+        std::queue<int> queue;
+        itemIndex.assign(lr0States.size(), -1);
 
-        queue.push(closureIndexMap.emplace(std::move(startClosure), 0).first);
+        auto findClosure = [&](LALRClosure const &lalrClosure) {
+            auto range = closureIndexMap.equal_range(kernelHash(lalrClosure));
+            for (auto it = range.first; it != range.second; ++it) {
+                if (sameKernel(lalrClosures[it->second], lalrClosure))
+                    return it->second;
+            }
+            return -1;
+        };
+        auto addClosure = [&](LALRClosure &&lalrClosure) {
+            auto closureID = static_cast<int>(lalrClosures.size());
+            closureIndexMap.emplace(kernelHash(lalrClosure), closureID);
+            lalrClosures.push_back(std::move(lalrClosure));
+            queue.push(closureID);
+            return closureID;
+        };
+
+        // Prepare the first closures, one per start symbol.
+        for (auto lr0Start : nfa.getStartStates()) {
+            auto const &startState = lr0States[lr0Start];
+            LALRClosure startClosure;
+            auto s0 = M.addPseudoState();
+            M.markStartState(s0);
+            startClosure.push_back({lr0Start, *startState.constraint});
+            makeClosure(lr0States, startClosure);
+
+            auto const &labels = kernelLabelMap[startState.productionID];
+            step::addState(s0, std::string{labels.front()} + ", $");
+            step::setStart(s0);
+            step::show("Add start state.");
+
+            addClosure(std::move(startClosure));
+        }
+        util::Formatter f;
 
         while (!queue.empty()) {
-            auto closureIter = queue.front();
+            auto fromID = queue.front();
             queue.pop();
 
             // Try different actions
@@ -168,64 +208,61 @@ class LALRParser : public LRParser {
                     
                 auto actionID = static_cast<ActionID>(i);
                 auto newClosure =
-                    transit(lr0States, actionID, closureIter->first);
+                    transit(lr0States, actionID, lalrClosures[fromID]);
 
                 // Cannot accept this action
                 if (newClosure.empty()) {
                     continue;
                 }
                 
-                auto iter = closureIndexMap.find(newClosure);
-                if (iter == closureIndexMap.end()) {
+                auto toID = findClosure(newClosure);
+                if (toID < 0) {
                     // Add new closure
+                    std::string stateInfo;
+                    if (step::enabled())
+                        stateInfo = this->dumpLALRClosure(newClosure);
                     auto closureID =
-                        static_cast<StateID>(closureIndexMap.size());
-                    std::string stateInfo = this->dumpLALRClosure(newClosure);
-                    queue.push(closureIndexMap
-                                   .emplace(std::move(newClosure), closureID)
-                                   .first);
+                        static_cast<StateID>(addClosure(std::move(newClosure)));
                     M.addPseudoState();
                     // Add link to this closure
-                    M.addTransition(StateID{closureIter->second}, closureID,
-                                    actionID);
+                    M.addTransition(StateID{fromID}, closureID, actionID);
 
+                    if (!step::enabled())
+                        continue;
                     step::addState(closureID, stateInfo);
-                    step::addEdge(closureIter->second, closureID,
-                                  M.actions[actionID]);
-                    auto message = f.formatView("Trans(s%d, %s) = s%d",
-                                                closureIter->second,
+                    step::addEdge(fromID, closureID, M.actions[actionID]);
+                    auto message = f.formatView("Trans(s%d, %s) = s%d", fromID,
                                                 M.actions[actionID], closureID);
                     step::show(message);
                 } else {
                     // Merge closures.
-                    // Now number of elements in two maps should be the same.
+                    // Now number of items in two closures should be the same.
                     bool flag = false;
-                    auto i1 = iter->first.begin(), e1 = iter->first.end();
-                    auto i2 = newClosure.begin();
-                    for (; i1 != e1; (void)++i1, (void)++i2) {
-                        auto before = i1->second;
-                        *const_cast<Constraint *>(&i1->second) |= i2->second;
-                        if (i1->second != before)
+                    auto &target = lalrClosures[toID];
+                    for (size_t j = 0; j < target.size(); ++j) {
+                        if (target[j].constraint.orAssignChanged(
+                                newClosure[j].constraint))
                             flag = true;
                     }
-                    M.addTransition(StateID{closureIter->second},
-                                    StateID{iter->second}, actionID);
+                    M.addTransition(StateID{fromID}, StateID{toID}, actionID);
                     // The merged state should be checked again
                     if (flag) {
-                        queue.push(iter);
+                        queue.push(toID);
                     }
 
-                    step::addEdge(closureIter->second, iter->second, M.actions[actionID]);
-                    step::updateState(iter->second, this->dumpLALRClosure(newClosure));
+                    if (!step::enabled())
+                        continue;
+                    step::addEdge(fromID, toID, M.actions[actionID]);
+                    step::updateState(toID, this->dumpLALRClosure(newClosure));
                     auto message = f.formatView(
-                        "Trans(s%d, %s) = s%d", closureIter->second,
-                        M.actions[actionID], iter->second);
+                        "Trans(s%d, %s) = s%d", fromID,
+                        M.actions[actionID], toID);
                     step::show(message);
                 }
             }
         }
 
-        // Now we have all closureIndexMap, we have to put them into automaton.
+        // Now we have all closures, we have to put them into automaton.
         auto hashFunc = [](const Constraint *arg) {
             return std::hash<Constraint>()(*arg);
         };
@@ -247,33 +284,35 @@ class LALRParser : public LRParser {
         };
         // 1. Add aux states
         // 2. Build bitset
-        auto lr0AuxEnd = this->auxEnd;
+        auto lr0AuxEnds = std::move(this->auxEnds);
+        this->auxEnds.clear();
         std::vector<State> &auxStates = M.auxStates; // Size is unknown yet
-        M.closures.resize(closureIndexMap.size());   // Size is known
+        M.closures.resize(lalrClosures.size());      // Size is known
         assert(auxStates.empty());
-        for (auto &[lalrClosure, closureIndex] : closureIndexMap) {
+        for (size_t closureIndex = 0; closureIndex < lalrClosures.size();
+             ++closureIndex) {
+            auto &lalrClosure = lalrClosures[closureIndex];
             // BitSet that will be moved into automaton.
             Closure closure;
             for (auto &[lr0State, constraint] : lalrClosure) {
                 auto auxIndex = static_cast<StateID>(auxStates.size());
                 // Copy original state and change its ID and constraint
                 State auxState = lr0States[lr0State];
-                auxState.constraint =
-                    storeConstraint(const_cast<Constraint *>(&constraint));
+                auxState.constraint = storeConstraint(&constraint);
                 auxStates.push_back(auxState);
                 closure.insert(auxIndex);
-                if (lr0State == lr0AuxEnd) {
-                    assert(this->auxEnd == lr0AuxEnd ||
-                           this->auxEnd == auxIndex);
-                    this->auxEnd = StateID{auxIndex};
+                if (std::find(lr0AuxEnds.begin(), lr0AuxEnds.end(),
+                              lr0State) != lr0AuxEnds.end()) {
+                    this->auxEnds.push_back(auxIndex);
                 }
             }
             M.closures[closureIndex] = std::move(closure);
         }
+        M.freeze();
 
         display(AUTOMATON, INFO, "DFA is built", &dfa, (void *)"DFA");
 
-        int sz = (int)M.closures.size();
+        int sz = step::enabled() ? (int)M.closures.size() : 0;
         for (int i = 0; i < sz; ++i) {
             step::updateState(i, M.dumpClosureString(StateID{i}));
         }
@@ -285,7 +324,7 @@ class LALRParser : public LRParser {
     // for us.
     [[nodiscard]] Constraint *
     resolveLocalConstraints(const Constraint *parentConstraint,
-                            const Production &production,
+                            ProductionID prodID,
                             int rhsIndex) override {
         return allTermConstraint;
     }
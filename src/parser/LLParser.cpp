@@ -0,0 +1,267 @@
+#include "src/parser/LLParser.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+#include "src/grammar/GrammarReader.h"
+#include "src/util/Formatter.h"
+#include "src/util/TokenReader.h"
+
+namespace gram {
+
+void LLParser::buildParseTable() {
+    auto const &symbols = gram.getAllSymbols();
+    auto const &productions = gram.getProductionTable();
+    auto epsilon = gram.getEpsilonSymbol().id;
+
+    columns = symbols.size();
+    parseTable.assign(columns, {});
+    conflicts.clear();
+    for (auto const &symbol : symbols)
+        if (symbol.type == SymbolType::NON_TERM)
+            parseTable[symbol.id].resize(columns);
+
+    auto addEntry = [&](SymbolID head, SymbolID term, ProductionID prodID) {
+        if (term == epsilon)
+            return;
+        auto &cell = parseTable[head][term];
+        cell.insert(prodID);
+        if (cell.size() > 1)
+            conflicts.emplace(head, term);
+    };
+    // Predict A -> α on First(α), and also on Follow(A) if α is nullable.
+    for (size_t i = 0; i < productions.size(); ++i) {
+        auto prodID = static_cast<ProductionID>(i);
+        auto head = productions[i].leftSymbol;
+        gram.suffixFirstSet(prodID, 0).forEach(
+            [&](SymbolID term) { addEntry(head, term, prodID); });
+        if (gram.suffixNullable(prodID, 0))
+            symbols[head].followSet.forEach(
+                [&](SymbolID term) { addEntry(head, term, prodID); });
+    }
+
+    predictions.assign(columns * columns, ProductionID{-1});
+    for (size_t head = 0; head < columns; ++head) {
+        auto const &row = parseTable[head];
+        for (size_t term = 0; term < row.size(); ++term)
+            if (row[term].size() == 1)
+                predictions[head * columns + term] = *row[term].begin();
+    }
+
+    display(LL_PARSE_TABLE, INFO, "LL(1) parse table", this);
+}
+
+void LLParser::printSummary() const {
+    auto const &symbols = gram.getAllSymbols();
+    auto const &productions = gram.getProductionTable();
+    printf("> Summary: %zd productions, %zd table cell conflicts.\n",
+           productions.size(), conflicts.size());
+    if (!conflicts.empty()) {
+        int conflictIndex = 0;
+        printf("\nConflicts happen at:\n");
+        for (auto const &[head, term] : conflicts) {
+            printf("   %3d) Nonterminal %s, Symbol %s\n", ++conflictIndex,
+                   symbols[head].name.c_str(), symbols[term].name.c_str());
+        }
+    }
+}
+
+void LLParser::setEntry(SymbolID id) {
+    if (!gram.isStartSymbol(id)) {
+        auto const &symbols = gram.getAllSymbols();
+        auto name = id >= 0 && static_cast<size_t>(id) < symbols.size()
+                        ? symbols[id].name
+                        : std::to_string(id);
+        throw std::runtime_error(name + " is not a start symbol");
+    }
+    entry = id;
+}
+
+bool LLParser::parse(util::Span<SymbolID const> tokens) {
+    ParseListener *sink = listener;
+    if (listener && gram.isTransformed()) {
+        listenerOrigins.setTarget(listener);
+        sink = &listenerOrigins;
+    }
+    return run(tokens, nullptr, sink);
+}
+
+bool LLParser::run(util::Span<SymbolID const> tokens, ParseListener *treeSink,
+                   ParseListener *listenerSink) {
+    auto const &symbols = gram.getAllSymbols();
+    auto const &productions = gram.getProductionTable();
+    auto endOfInput = gram.getEndOfInputSymbol().id;
+    // Markers are only needed to report reductions.
+    bool events = treeSink || listenerSink;
+    if (treeSink)
+        treeSink->onStart();
+    if (listenerSink)
+        listenerSink->onStart();
+
+    stack.clear();
+    stack.push_back(endOfInput);
+    stack.push_back(entry >= 0 ? entry : gram.getStartSymbol().id);
+    errorPosition = -1;
+    expansions = 0;
+    size_t position = 0;
+
+    while (true) {
+        int top = stack.back();
+        if (top < 0) {
+            // All of the body is matched.
+            stack.pop_back();
+            auto const &prod = productions[-1 - top];
+            auto prodID = static_cast<ProductionID>(-1 - top);
+            auto bodySize = prod.rightSymbols.size();
+            if (treeSink)
+                treeSink->onReduce(prodID, prod.leftSymbol, bodySize);
+            if (listenerSink)
+                listenerSink->onReduce(prodID, prod.leftSymbol, bodySize);
+            continue;
+        }
+
+        auto token = position < tokens.size() ? tokens[position] : endOfInput;
+        if (symbols[top].type == SymbolType::TERM) {
+            if (top != token)
+                break;
+            stack.pop_back();
+            if (token == endOfInput) {
+                if (treeSink)
+                    treeSink->onAccept();
+                if (listenerSink)
+                    listenerSink->onAccept();
+                return true;
+            }
+            if (treeSink)
+                treeSink->onShift(token);
+            if (listenerSink)
+                listenerSink->onShift(token);
+            ++position;
+            continue;
+        }
+
+        auto prodID = predictions[top * columns + token];
+        if (prodID < 0)
+            break;
+        ++expansions;
+        if (events)
+            stack.back() = -1 - prodID;
+        else
+            stack.pop_back();
+        auto const &rhs = productions[prodID].rightSymbols;
+        stack.insert(stack.end(), rhs.rbegin(), rhs.rend());
+    }
+
+    errorPosition = static_cast<int>(position);
+    errorTop = stack.back();
+    return false;
+}
+
+SymbolID LLParser::toInputSymbol(std::string const &s) const {
+    auto const &symbol = gram.findSymbol(s);
+    if (symbol.type == SymbolType::NON_TERM) {
+        throw std::runtime_error("Non-terminals as inputs are not allowed");
+    }
+    if (symbol.id == gram.getEpsilonSymbol().id) {
+        throw std::runtime_error("Epsilon cannot be used in input");
+    } else if (gram.hasErrorSymbol() &&
+               symbol.id == gram.getErrorSymbol().id) {
+        throw std::runtime_error("Error token cannot be used in input");
+    }
+    return symbol.id;
+}
+
+std::vector<SymbolID> LLParser::tokenize(std::istream &stream) const {
+    GrammarReader grammarReader(stream);
+    util::TokenReader tokenReader(stream);
+    util::TokenReader &reader = launchArgs.strict ? grammarReader : tokenReader;
+
+    auto EOI = gram.getEndOfInputSymbol().id;
+    std::vector<SymbolID> tokens;
+    std::string s;
+    while (reader.getToken(s)) {
+        tokens.push_back(toInputSymbol(s));
+        if (tokens.back() == EOI)
+            return tokens;
+    }
+    tokens.push_back(EOI);
+    return tokens;
+}
+
+bool LLParser::test(std::istream &stream) try {
+    display(LOG, INFO,
+            "Please input symbols for test (Use '$' to end the input)");
+    auto tokens = tokenize(stream);
+
+    ParseListener *treeSink = &treeBuilder;
+    ParseListener *listenerSink = listener;
+    if (gram.isTransformed()) {
+        treeOrigins.setTarget(treeSink);
+        treeSink = &treeOrigins;
+        if (listener) {
+            listenerOrigins.setTarget(listener);
+            listenerSink = &listenerOrigins;
+        }
+    }
+    if (run(tokens, treeSink, listenerSink)) {
+        display(LOG, INFO, "Success");
+        return true;
+    }
+
+    util::Formatter f;
+    auto const &symbols = gram.getAllSymbols();
+    auto token = tokens[errorPosition];
+    if (symbols[errorTop].type == SymbolType::NON_TERM &&
+        parseTable[errorTop][token].size() > 1) {
+        throw std::runtime_error(
+            f.formatView("Multiple productions of %s are predicted by %s. "
+                         "Cannot decide which one to take",
+                         symbols[errorTop].name.c_str(),
+                         symbols[token].name.c_str())
+                .data());
+    }
+    throw std::runtime_error(
+        f.formatView("Syntax error at token %d (%s), expected: %s",
+                     errorPosition, symbols[token].name.c_str(),
+                     dumpExpected().c_str())
+            .data());
+} catch (std::runtime_error const &e) {
+    display(LOG, ERR, e.what());
+    return false;
+}
+
+std::string LLParser::dumpExpected() const {
+    auto const &symbols = gram.getAllSymbols();
+    if (symbols[errorTop].type == SymbolType::TERM)
+        return symbols[errorTop].name;
+    std::string s;
+    auto const &row = parseTable[errorTop];
+    for (size_t term = 0; term < row.size(); ++term) {
+        if (row[term].empty())
+            continue;
+        if (!s.empty())
+            s += ", ";
+        s += symbols[term].name;
+    }
+    return s;
+}
+
+std::string LLParser::dumpParseTableEntry(SymbolID nonterm,
+                                          ActionID term) const {
+    auto const &prods = parseTable.at(nonterm).at(term);
+    std::string s;
+    bool commaFlag = false;
+    for (auto prodID : prods) {
+        if (commaFlag)
+            s += ',';
+        commaFlag = true;
+        s += std::to_string(prodID);
+    }
+    return s;
+}
+
+} // namespace gram
@@ -0,0 +1,110 @@
+#ifndef LRPARSER_LL_H
+#define LRPARSER_LL_H
+
+#include <istream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+#include "src/parser/OriginListener.h"
+#include "src/parser/ParseListener.h"
+#include "src/parser/SyntaxTree.h"
+#include "src/util/Span.h"
+
+namespace gram {
+
+// A predictive LL(1) parser. The table is built from the nullable, First and
+// Follow sets of the grammar, so no automaton is needed: the cell of
+// nonterminal A and terminal a holds the productions A -> α with a in
+// First(α), or with α nullable and a in Follow(A).
+//
+// Like LRParser, cells with more than one production are reported as
+// conflicts, and the driver stops at them.
+//
+// The driver reports the events of a bottom-up parse to listeners: a marker
+// is pushed under the body of each predicted production, and the reduction is
+// reported when the marker is popped. So CSTBuilder and SemanticStack work as
+// they do with LRParser.
+class LLParser {
+  public:
+    // Indexed by nonterminal and terminal. Rows of terminals are empty.
+    using ParseTable = std::vector<std::vector<std::set<ProductionID>>>;
+
+    explicit LLParser(Grammar const &g)
+        : gram(g), treeBuilder(tree, g), treeOrigins(g), listenerOrigins(g) {}
+
+    void buildParseTable();
+    // Prints the number of productions and the conflicts of the table.
+    void printSummary() const;
+
+    // Parses tokens ending with "$". Listeners receive the events, but
+    // nothing is printed. Returns whether the input is accepted.
+    bool parse(util::Span<SymbolID const> tokens);
+    // Reads the input like LRParser::test(), parses it, builds the syntax
+    // tree and reports errors.
+    bool test(std::istream &stream);
+
+    // Reads all symbols up to "$" (or the end of the stream). "$" is always
+    // the last element.
+    [[nodiscard]] std::vector<SymbolID> tokenize(std::istream &stream) const;
+
+    // Selects the start symbol. It must be one of the grammar's start
+    // symbols.
+    void setEntry(SymbolID entry);
+    // Attach a listener which receives shift and reduce events in parse() and
+    // test(). Pass nullptr to detach. The listener is not owned.
+    void setListener(ParseListener *l) { listener = l; }
+
+    [[nodiscard]] auto const &getGrammar() const { return gram; }
+    [[nodiscard]] auto const &getParseTable() const { return parseTable; }
+    [[nodiscard]] auto const &getConflicts() const { return conflicts; }
+    // Concrete syntax tree built by the last call to test().
+    [[nodiscard]] auto const &getSyntaxTree() const { return tree; }
+    // Index of the token which the last parse failed at, or -1.
+    [[nodiscard]] int getErrorPosition() const { return errorPosition; }
+    // Productions predicted by the last parse.
+    [[nodiscard]] size_t getExpansions() const { return expansions; }
+
+    // Format
+    [[nodiscard]] std::string dumpParseTableEntry(SymbolID nonterm,
+                                                  ActionID term) const;
+
+  private:
+    Grammar const &gram;
+    SymbolID entry{-1};
+    ParseTable parseTable;
+    // The production predicted by each cell, or -1 if there is none or more
+    // than one. Rows of `columns` entries, indexed like parseTable.
+    std::vector<ProductionID> predictions;
+    size_t columns = 0;
+    std::set<std::pair<int, int>> conflicts;
+
+    // Symbols to match or expand, top at the back. A negative entry -1 - p
+    // is the marker of production p.
+    std::vector<int> stack;
+    int errorPosition = -1;
+    size_t expansions = 0;
+    // Top of the stack when the last parse failed.
+    int errorTop = 0;
+
+    ParseListener *listener = nullptr;
+    SyntaxTree tree;
+    CSTBuilder treeBuilder;
+    // Used like in LRParser if the grammar is transformed.
+    OriginListener treeOrigins;
+    OriginListener listenerOrigins;
+
+    [[nodiscard]] SymbolID toInputSymbol(std::string const &s) const;
+    // Runs the driver and reports events to the sinks, which may be nullptr.
+    bool run(util::Span<SymbolID const> tokens, ParseListener *treeSink,
+             ParseListener *listenerSink);
+    // Names of the terminals which were expected when the parse failed.
+    [[nodiscard]] std::string dumpExpected() const;
+};
+
+} // namespace gram
+
+#endif
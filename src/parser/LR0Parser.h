@@ -15,7 +15,7 @@ class LR0Parser : public LRParser {
   protected:
     [[nodiscard]] Constraint *
     resolveLocalConstraints(const Constraint *parentConstraint,
-                            const Production &production,
+                            ProductionID prodID,
                             int rhsIndex) override {
         return allTermConstraint;
     }
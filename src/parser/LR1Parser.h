@@ -35,21 +35,19 @@ class LR1Parser : public LRParser {
 
     [[nodiscard]] Constraint *
     resolveLocalConstraints(const Constraint *parentConstraint,
-                            const Production &production,
+                            ProductionID prodID,
                             int rhsIndex) override {
-        auto const &symbols = gram.getAllSymbols();
-        auto const &rhs = production.rightSymbols;
-        Constraint constraint(symbols.size());
-
-        bool allNullable = true;
-        for (size_t i = rhsIndex + 1; allNullable && i < rhs.size(); ++i) {
-            if (!symbols[rhs[i]].nullable)
-                allNullable = false;
-            constraint |= symbols[rhs[i]].firstSet;
+        // Nothing follows S in "S' -> S".
+        if (prodID >= (int)gram.getProductionTable().size()) {
+            Constraint constraint(gram.getAllSymbols().size());
+            if (parentConstraint)
+                constraint |= *parentConstraint;
+            return newConstraint(std::move(constraint));
         }
-        if (allNullable && parentConstraint)
-            constraint |= *parentConstraint;
 
+        Constraint constraint(gram.suffixFirstSet(prodID, rhsIndex + 1));
+        if (parentConstraint && gram.suffixNullable(prodID, rhsIndex + 1))
+            constraint |= *parentConstraint;
         return newConstraint(std::move(constraint));
     }
 };
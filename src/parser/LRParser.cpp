@@ -1,5 +1,6 @@
 #include "src/parser/LRParser.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <memory>
@@ -25,8 +26,10 @@ void LRParser::buildKernel() {
     const auto &symbols = gram.getAllSymbols();
 
     // Initialize outer dimension.
-    // We want to put "S' -> S" in the last position.
-    kernelLabelMap = decltype(kernelLabelMap)(productionTable.size() + 1);
+    // We want to put "S' -> S" of each start symbol at the end.
+    auto const &starts = gram.getStartSymbols();
+    kernelLabelMap =
+        decltype(kernelLabelMap)(productionTable.size() + starts.size());
 
     // For normal productions.
     for (size_t prodID = 0; prodID < productionTable.size(); ++prodID) {
@@ -57,13 +60,15 @@ void LRParser::buildKernel() {
     }
 
     // For "S' -> S".
-    std::vector<const char *> augLabelVec(2);
-    const auto &startName = gram.getStartSymbol().name;
-    augLabelVec[0] =
-        newString(startName + "' -> " + Constants::dot + " " + startName);
-    augLabelVec[1] =
-        newString(startName + "' -> " + startName + " " + Constants::dot);
-    kernelLabelMap[productionTable.size()] = std::move(augLabelVec);
+    for (size_t i = 0; i < starts.size(); ++i) {
+        std::vector<const char *> augLabelVec(2);
+        const auto &startName = symbols[starts[i]].name;
+        augLabelVec[0] =
+            newString(startName + "' -> " + Constants::dot + " " + startName);
+        augLabelVec[1] =
+            newString(startName + "' -> " + startName + " " + Constants::dot);
+        kernelLabelMap[productionTable.size() + i] = std::move(augLabelVec);
+    }
 
     // Build `allTermConstraint`
     auto symbolCount = static_cast<int>(symbols.size());
@@ -78,6 +83,7 @@ void LRParser::buildKernel() {
 }
 
 void LRParser::buildNFA() {
+    util::BlockArena::Scope arenaScope(blockArena);
     PushDownAutomaton &M = this->nfa;
     const auto &symbols = gram.getAllSymbols();
     auto const &productionTable = gram.getProductionTable();
@@ -126,27 +132,27 @@ void LRParser::buildNFA() {
     M.setEndOfInputAction(gram.getEndOfInputSymbol().id);
     M.setEpsilonAction(gram.getEpsilonSymbol().id);
 
-    // Create S' (start symbol in augmented grammar) for S
-    {
+    // Create S' (start symbol in augmented grammar) for each start symbol S.
+    // All of them share the states built below.
+    auto const &starts = gram.getStartSymbols();
+    auxEnds.clear();
+    for (size_t i = 0; i < starts.size(); ++i) {
         auto constraints = newConstraint(symbols.size());
         constraints->insert(
             static_cast<ActionID>(gram.getEndOfInputSymbol().id));
-        auto augProdID = static_cast<ProductionID>(productionTable.size());
+        auto augProdID = static_cast<ProductionID>(productionTable.size() + i);
         StateID s0 = M.addState(augProdID, 0, constraints);
         StateID s1 = M.addState(augProdID, 1, constraints);
 
-        auto &start = gram.getStartSymbol();
+        auto &start = symbols[starts[i]];
         M.addTransition(s0, s1, static_cast<ActionID>(start.id));
         M.markStartState(s0);
         //        M.markFinalState(s1);
         //        this->extendedStart = s0;
-        this->auxEnd = s1;
+        this->auxEnds.push_back(s1);
 
-        Production augProduction{
-            SymbolID{-1}, std::vector<SymbolID>{gram.getStartSymbol().id}};
-        addNewDependency(
-            s0, start.id,
-            resolveLocalConstraints(constraints, augProduction, 0));
+        addNewDependency(s0, start.id,
+                         resolveLocalConstraints(constraints, augProdID, 0));
     }
 
     // Process all seeds
@@ -175,7 +181,7 @@ void LRParser::buildNFA() {
                 // Add new dependency
                 if (curSymbol.type == SymbolType::NON_TERM) {
                     auto constraint = resolveLocalConstraints(
-                        seedIter->first.second, production, i);
+                        seedIter->first.second, productionID, i);
                     addNewDependency(s1, curSymbol.id, constraint);
                 }
             }
@@ -194,17 +200,20 @@ void LRParser::buildNFA() {
             M.addEpsilonTransition(from, to);
         }
     }
+    M.freeze();
 
     display(AUTOMATON, INFO, "NFA is built", &M, (void *)"NFA");
 }
 
 void LRParser::buildDFA() {
+    util::BlockArena::Scope arenaScope(blockArena);
     // Dump flag is inherited from NFA, no need to set again.
     dfa = nfa.toDFA();
     display(AUTOMATON, INFO, "DFA is built", &dfa, (void *)"DFA");
 }
 
 void LRParser::buildParseTable() {
+    util::BlockArena::Scope arenaScope(blockArena);
     auto const &states = dfa.getAllStates();
     auto const &closures = dfa.getClosures();
     auto const &symbols = gram.getAllSymbols();
@@ -215,8 +224,7 @@ void LRParser::buildParseTable() {
     for (int i = 0; i < stateCount; ++i) {
         auto stateID = static_cast<StateID>(i);
         // "Shift" and "Goto" items
-        auto const &trans = states[stateID].transitions;
-        for (auto const &tran : *trans) {
+        for (auto const &tran : dfa.transitionsOf(stateID)) {
             ParseAction item{symbols[tran.action].type == SymbolType::TERM
                                  ? ParseAction::SHIFT
                                  : ParseAction::GOTO,
@@ -224,33 +232,43 @@ void LRParser::buildParseTable() {
             addParseTableEntry(stateID, tran.action, item);
         }
         // Process "Reduce" items
-        for (auto auxStateID : closures[stateID]) {
+        closures[stateID].forEach([&](StateID auxStateID) {
             auto const &auxState = auxStates[auxStateID];
             ProductionID prodID = auxState.productionID;
             // Skip those which cannot be reduced.
-            // prodID should be valid and not refer to the pseudo production
+            // prodID should be valid and not refer to the pseudo productions
             // "S' -> S".
-            if (prodID < 0 || prodID + 1 >= (int)kernelLabelMap.size() ||
+            if (prodID < 0 ||
+                prodID >= (int)gram.getProductionTable().size() ||
                 auxState.rhsIndex + 1 != kernelLabelMap[prodID].size()) {
-                continue;
+                return;
             }
-            for (auto actionID : *auxStates[auxStateID].constraint) {
+            auxState.constraint->forEach([&](ActionID actionID) {
                 addParseTableEntry(stateID, actionID,
                                    ParseAction{ParseAction::REDUCE, prodID});
+            });
+        });
+        // Process "Accept" item. Each start state reaches its own.
+        for (auto auxEnd : auxEnds) {
+            if (closures[stateID].contains(auxEnd)) {
+                addParseTableEntry(stateID, endOfInput,
+                                   ParseAction{ParseAction::SUCCESS, -1});
             }
         }
-        // Process "Accept" item.
-        if (closures[stateID].contains(this->auxEnd)) {
-            addParseTableEntry(stateID, endOfInput,
-                               ParseAction{ParseAction::SUCCESS, -1});
-        }
     }
+    buildExpectedTerminals();
 
     display(PARSE_TABLE, INFO, "Parse table", this);
+}
 
-    // Print summary
+void LRParser::printSummary() const {
+    auto const &states = dfa.getAllStates();
+    auto const &symbols = gram.getAllSymbols();
     printf("> Summary: %zd states, %zd table cell conflicts.\n", states.size(),
            parseTableConflicts.size());
+    if (resolvedConflicts)
+        printf("> %zu shift/reduce conflict(s) resolved by precedence.\n",
+               resolvedConflicts);
     if (!parseTableConflicts.empty()) {
         int conflictIndex = 0;
         printf("\nConflicts happen at:\n");
@@ -295,13 +313,166 @@ void LRParser::addParseTableEntry(StateID state, ActionID act,
             dfa.getAllStates().size(),
             vector<set<ParseAction>>(gram.getAllSymbols().size()));
     }
+    if (nonassocErrors.count({state, act}) ||
+        resolveByPrecedence(state, act, pact))
+        return;
     auto &entrySet = parseTable[state][act];
     entrySet.insert(pact);
     if (entrySet.size() > 1) {
         parseTableConflicts.emplace(state, act);
     }
-    auto entry = singleParseTableEntry(pact);
-    step::addTableEntry(state, act, entry.c_str());
+    if (step::enabled()) {
+        auto entry = singleParseTableEntry(pact);
+        step::addTableEntry(state, act, entry.c_str());
+    }
+}
+
+bool LRParser::resolveByPrecedence(StateID state, ActionID act,
+                                   ParseAction pact) {
+    auto &cell = parseTable[state][act];
+    if (cell.size() != 1)
+        return false;
+    auto other = *cell.begin();
+    auto shift = pact.type == ParseAction::SHIFT ? pact : other;
+    auto reduce = pact.type == ParseAction::REDUCE ? pact : other;
+    if (shift.type != ParseAction::SHIFT || reduce.type != ParseAction::REDUCE)
+        return false;
+
+    // The production has the precedence of its terminal, and the lookahead
+    // its own.
+    auto const &symbols = gram.getAllSymbols();
+    auto const &lookahead = symbols[act];
+    auto precSymbol = gram.getProductionTable()[reduce.productionID].precSymbol;
+    if (!lookahead.precedence || precSymbol < 0 ||
+        !symbols[precSymbol].precedence)
+        return false;
+    auto prodPrec = symbols[precSymbol].precedence;
+
+    const char *result;
+    cell.clear();
+    if (prodPrec > lookahead.precedence ||
+        (prodPrec == lookahead.precedence &&
+         lookahead.associativity == Associativity::LEFT)) {
+        cell.insert(reduce);
+        result = "reduce";
+    } else if (prodPrec < lookahead.precedence ||
+               lookahead.associativity == Associativity::RIGHT) {
+        cell.insert(shift);
+        result = "shift";
+    } else {
+        nonassocErrors.emplace(state, act);
+        result = "error";
+    }
+    ++resolvedConflicts;
+
+    // The entry which was in the cell is already in the trace.
+    if (step::enabled() && !cell.count(other)) {
+        auto entry = singleParseTableEntry(other);
+        step::removeTableEntry(state, act, entry.c_str());
+    }
+    if (step::enabled() && cell.count(pact)) {
+        auto entry = singleParseTableEntry(pact);
+        step::addTableEntry(state, act, entry.c_str());
+    }
+    util::Formatter f;
+    display(LOG, VERBOSE,
+            f.formatView("State %d, symbol %s: shift/reduce conflict with "
+                         "production %d is resolved as %s by precedence",
+                         state, lookahead.name.c_str(), reduce.productionID,
+                         result)
+                .data());
+    return true;
+}
+
+StateID LRParser::getStartState(SymbolID entry) const {
+    auto const &starts = gram.getStartSymbols();
+    auto it = std::find(starts.begin(), starts.end(), entry);
+    if (it == starts.end()) {
+        auto const &symbols = gram.getAllSymbols();
+        auto name = entry >= 0 && static_cast<size_t>(entry) < symbols.size()
+                        ? symbols[entry].name
+                        : std::to_string(entry);
+        throw std::runtime_error(name + " is not a start symbol");
+    }
+    return dfa.getStartStates()[it - starts.begin()];
+}
+
+void LRParser::buildExpectedTerminals() {
+    auto const &symbols = gram.getAllSymbols();
+    auto stateCount = dfa.getAllStates().size();
+    expectedTerminals.assign(stateCount, util::BitSet<ActionID>());
+    defaultReductions.assign(stateCount, ProductionID{-1});
+    if (parseTable.empty())
+        return;
+
+    for (size_t state = 0; state < stateCount; ++state) {
+        auto &expected = expectedTerminals[state];
+        // Stays -1 if any cell is not the same single reduction.
+        int reduction = -1;
+        bool onlyReduce = true;
+        for (size_t sym = 0; sym < symbols.size(); ++sym) {
+            auto const &cell = parseTable[state][sym];
+            if (cell.empty() || symbols[sym].type != SymbolType::TERM)
+                continue;
+            expected.insert(static_cast<ActionID>(sym));
+            auto const &pact = *cell.begin();
+            if (cell.size() != 1 || pact.type != ParseAction::REDUCE ||
+                (reduction >= 0 && reduction != pact.productionID)) {
+                onlyReduce = false;
+                continue;
+            }
+            reduction = pact.productionID;
+        }
+        if (onlyReduce && reduction >= 0)
+            defaultReductions[state] = static_cast<ProductionID>(reduction);
+    }
+}
+
+util::BitSet<ActionID>
+LRParser::getExpectedTerminals(util::Span<StateID const> stack) const {
+    util::BitSet<ActionID> result;
+    if (stack.empty())
+        return result;
+    result = expectedTerminals[stack.back()];
+
+    // Only the top part of the stack changes, so the states below it are
+    // read from `stack` directly.
+    std::vector<StateID> top{stack.back()};
+    size_t below = stack.size() - 1;
+    auto const &prods = gram.getProductionTable();
+    // A conflict-free table has no cycle of default reductions, but the walk
+    // is bounded anyway.
+    for (size_t steps = 0; steps < expectedTerminals.size(); ++steps) {
+        auto prodID = defaultReductions[top.back()];
+        if (prodID < 0)
+            break;
+        auto bodySize = prods[prodID].rightSymbols.size();
+        while (top.size() <= bodySize) {
+            if (below == 0)
+                return result;
+            top.insert(top.begin(), stack[--below]);
+        }
+        top.resize(top.size() - bodySize);
+        auto const &cell = parseTable[top.back()][prods[prodID].leftSymbol];
+        if (cell.size() != 1 || cell.begin()->type != ParseAction::GOTO)
+            break;
+        top.push_back(cell.begin()->dest);
+        // A terminal must be accepted by every state on the way.
+        result &= expectedTerminals[top.back()];
+    }
+    return result;
+}
+
+std::string
+LRParser::dumpTerminals(util::BitSet<ActionID> const &terms) const {
+    auto const &symbols = gram.getAllSymbols();
+    std::string s;
+    for (auto term : terms) {
+        if (!s.empty())
+            s += ", ";
+        s += symbols[term].name;
+    }
+    return s;
 }
 
 std::string LRParser::dumpParseTableEntry(StateID state,
@@ -318,20 +489,46 @@ std::string LRParser::dumpParseTableEntry(StateID state,
     return s;
 }
 
+SymbolID LRParser::toInputSymbol(std::string const &s) const {
+    auto const &symbol = gram.findSymbol(s);
+    if (symbol.type == SymbolType::NON_TERM) {
+        throw std::runtime_error("Non-terminals as inputs are not allowed");
+    }
+    if (symbol.id == gram.getEpsilonSymbol().id) {
+        throw std::runtime_error("Epsilon cannot be used in input");
+    } else if (gram.hasErrorSymbol() &&
+               symbol.id == gram.getErrorSymbol().id) {
+        throw std::runtime_error("Error token cannot be used in input");
+    }
+    return symbol.id;
+}
+
+std::vector<SymbolID> LRParser::tokenize(std::istream &stream) const {
+    GrammarReader grammarReader(stream);
+    util::TokenReader tokenReader(stream);
+    util::TokenReader &reader = launchArgs.strict ? grammarReader : tokenReader;
+
+    auto EOI = gram.getEndOfInputSymbol().id;
+    std::vector<SymbolID> tokens;
+    std::string s;
+    while (reader.getToken(s)) {
+        tokens.push_back(toInputSymbol(s));
+        if (tokens.back() == EOI)
+            return tokens;
+    }
+    tokens.push_back(EOI);
+    return tokens;
+}
+
 void LRParser::readSymbol(util::TokenReader &reader) {
     std::string s;
     if (reader.getToken(s)) {
-        auto const &symbol = gram.findSymbol(s);
-        if (symbol.type == SymbolType::NON_TERM) {
-            throw std::runtime_error("Non-terminals as inputs are not allowed");
-        }
-        if (symbol.id == gram.getEpsilonSymbol().id) {
-            throw std::runtime_error("Epsilon cannot be used in input");
-        } else if (symbol.id == gram.getEndOfInputSymbol().id) {
+        auto id = toInputSymbol(s);
+        if (id == gram.getEndOfInputSymbol().id) {
             inputFlag = false;
         }
-        InputQueue.push_back(symbol.id);
-        step::printf("input_queue.appendleft(%d)\n", symbol.id);
+        InputQueue.push_back(id);
+        step::printf("input_queue.appendleft(%d)\n", id);
     } else {
         inputFlag = false;
         auto EOI = gram.getEndOfInputSymbol().id;
@@ -347,9 +544,24 @@ bool LRParser::test(std::istream &stream) try {
     stateStack.clear();
     symbolStack.clear();
     InputQueue.clear();
-    astNodeStack.clear();
-    stateStack.push_back(dfa.getStartState());
-    step::printf("state_stack.append(%d)\n", dfa.getStartState());
+    syntaxErrors.clear();
+    inputPosition = 0;
+    errorStatus = 0;
+    treeSink = &treeBuilder;
+    listenerSink = listener;
+    if (gram.isTransformed()) {
+        treeOrigins.setTarget(treeSink);
+        treeSink = &treeOrigins;
+        if (listener) {
+            listenerOrigins.setTarget(listener);
+            listenerSink = &listenerOrigins;
+        }
+    }
+    treeSink->onStart();
+    if (listenerSink)
+        listenerSink->onStart();
+    stateStack.push_back(getStartState());
+    step::printf("state_stack.append(%d)\n", getStartState());
 
     // Only one of them is used
     GrammarReader grammarReader(stream);
@@ -373,7 +585,6 @@ bool LRParser::test(std::istream &stream) try {
     }
 
     util::Formatter f;
-    int astNodeIndex = 0;
 
     while (true) {
         if (InputQueue.empty() && inputFlag) {
@@ -389,6 +600,10 @@ bool LRParser::test(std::istream &stream) try {
 
         auto choices = tableEntry.size();
         if (choices <= 0) {
+            if (recover()) {
+                display(PARSE_STATES, INFO, "Parser states", this);
+                continue;
+            }
             step::show("Error: No viable actions for this input.");
             throw std::runtime_error(
                 "No viable action in parse table for this input");
@@ -406,19 +621,22 @@ bool LRParser::test(std::istream &stream) try {
         case ParseAction::GOTO:
             throw std::logic_error("Goto item should be processed by reduce()");
         case ParseAction::SHIFT: {
+            auto front = InputQueue.front();
+            if (listenerSink)
+                listenerSink->onShift(front);
+
             stateStack.push_back(decision.dest);
             step::printf("state_stack.append(%d)\n", decision.dest);
 
-            auto front = InputQueue.front();
             symbolStack.push_back(front);
             step::printf("symbol_stack.append(%d)\n", front);
-            step::astAddNode(astNodeIndex,
-                             getGrammar().getAllSymbols()[front].name);
-            astNodeStack.push_back(astNodeIndex);
-            astNodeIndex++;
+            treeSink->onShift(front);
 
             InputQueue.pop_front();
             step::printf("input_queue.pop()\n");
+            ++inputPosition;
+            if (errorStatus > 0)
+                --errorStatus;
 
             if (decision.type == ParseAction::GOTO) {
                 display(LOG, VERBOSE, "Apply GOTO rule");
@@ -430,13 +648,24 @@ bool LRParser::test(std::istream &stream) try {
             break;
         }
         case ParseAction::REDUCE:
-            reduce(decision.productionID, astNodeIndex++);
+            reduce(decision.productionID);
             display(LOG, VERBOSE,
                     f.formatView("Apply REDUCE by production: %d",
                                  decision.productionID)
                         .data());
             break;
         case ParseAction::SUCCESS:
+            treeSink->onAccept();
+            if (listenerSink)
+                listenerSink->onAccept();
+            if (!syntaxErrors.empty()) {
+                auto msg = f.formatView("Input is accepted after recovering "
+                                        "from %zd syntax error(s)",
+                                        syntaxErrors.size());
+                display(LOG, ERR, msg.data());
+                step::show(msg);
+                return false;
+            }
             display(LOG, INFO, "Success");
             step::show("Success.");
             return true;
@@ -449,8 +678,86 @@ bool LRParser::test(std::istream &stream) try {
     return false;
 }
 
+void LRParser::popStack(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        step::printf("symbol_stack.pop()\n");
+        step::printf("state_stack.pop()\n");
+    }
+    symbolStack.resize(symbolStack.size() - count);
+    stateStack.resize(stateStack.size() - count);
+    treeSink->onDiscard(count);
+    if (listenerSink)
+        listenerSink->onDiscard(count);
+}
+
+bool LRParser::recover() {
+    util::Formatter f;
+    auto const &symbols = gram.getAllSymbols();
+    auto lookahead = InputQueue.front();
+
+    // Errors right after a recovery are not reported, so one mistake does not
+    // produce a cascade of messages.
+    if (errorStatus == 0) {
+        syntaxErrors.push_back(
+            SyntaxError{inputPosition, stateStack.back(), lookahead});
+        auto expected = dumpTerminals(getExpectedTerminals(stateStack));
+        auto msg = f.formatView(
+            "Syntax error at token %zd (%s) in state %d, expected: %s",
+            inputPosition, symbols[lookahead].name.c_str(), stateStack.back(),
+            expected.c_str());
+        display(LOG, ERR, msg.data());
+        step::show(msg);
+    }
+
+    if (!gram.hasErrorSymbol())
+        return false;
+
+    // Already recovering: the token cannot follow "error", so discard it.
+    if (errorStatus == 3) {
+        if (lookahead == gram.getEndOfInputSymbol().id)
+            return false;
+        InputQueue.pop_front();
+        step::printf("input_queue.pop()\n");
+        ++inputPosition;
+        auto msg = f.formatView("Error recovery: discard token %s.",
+                                symbols[lookahead].name.c_str());
+        display(LOG, VERBOSE, msg.data());
+        step::show(msg);
+        return true;
+    }
+
+    // Pop states until one of them can shift "error".
+    errorStatus = 3;
+    auto errorID = gram.getErrorSymbol().id;
+    auto canShiftError = [this, errorID](StateID state) {
+        for (auto const &pact : parseTable[state][errorID]) {
+            if (pact.type == ParseAction::SHIFT)
+                return pact.dest;
+        }
+        return StateID{-1};
+    };
+    StateID dest;
+    while ((dest = canShiftError(stateStack.back())) < 0) {
+        if (stateStack.size() <= 1)
+            return false;
+        popStack(1);
+    }
+
+    treeSink->onShift(errorID);
+    if (listenerSink)
+        listenerSink->onShift(errorID);
+    stateStack.push_back(dest);
+    step::printf("state_stack.append(%d)\n", dest);
+    symbolStack.push_back(errorID);
+    step::printf("symbol_stack.append(%d)\n", errorID);
+
+    display(LOG, VERBOSE, "Error recovery: shift error token");
+    step::show("Error recovery: shift error token.");
+    return true;
+}
+
 // May throw errors
-void LRParser::reduce(ProductionID prodID, int astNodeIndex) {
+void LRParser::reduce(ProductionID prodID) {
     auto const &prod = gram.getProductionTable()[prodID];
     auto bodySize = prod.rightSymbols.size();
     if (symbolStack.size() < bodySize) {
@@ -468,18 +775,18 @@ void LRParser::reduce(ProductionID prodID, int astNodeIndex) {
         }
     }
     auto head = prod.leftSymbol;
-    step::astAddNode(astNodeIndex, getGrammar().getAllSymbols()[head].name);
 
     // Pop those states by production
     for (int i = 0; i < (int)bodySize; ++i) {
-        int node = astNodeStack[astNodeStack.size() - bodySize + i];
-        step::astSetParent(node, astNodeIndex);
         step::printf("symbol_stack.pop()\n");
         step::printf("state_stack.pop()\n");
     }
     symbolStack.resize(symbolStack.size() - bodySize);
     stateStack.resize(stateStack.size() - bodySize);
-    astNodeStack.resize(astNodeStack.size() - bodySize);
+    // The tree replaces the handle with a new node, and narrates it.
+    treeSink->onReduce(prodID, head, bodySize);
+    if (listenerSink)
+        listenerSink->onReduce(prodID, head, bodySize);
 
     // Used for underlining handles at the top of symbol stack.
     step::printf("reduce_hint(%zd)\n", symbolStack.size());
@@ -507,7 +814,6 @@ void LRParser::reduce(ProductionID prodID, int astNodeIndex) {
     }
     auto next = pact.dest;
     stateStack.push_back(next);
-    astNodeStack.push_back(astNodeIndex);
     step::printf("state_stack.append(%d)\n", next);
 
     std::string s = "Apply reduce rule: ";
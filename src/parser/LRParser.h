@@ -6,14 +6,19 @@
 #include <deque>
 #include <functional>
 #include <istream>
-#include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "src/automata/PushDownAutomaton.h"
 #include "src/grammar/Grammar.h"
+#include "src/parser/OriginListener.h"
+#include "src/parser/ParseListener.h"
+#include "src/parser/SyntaxTree.h"
+#include "src/util/Arena.h"
 #include "src/util/BitSet.h"
+#include "src/util/BlockArena.h"
 #include "src/util/ResourceProvider.h"
+#include "src/util/Span.h"
 #include "src/util/TokenReader.h"
 
 namespace gram {
@@ -45,6 +50,14 @@ class LRParser : public util::ResourceProvider<TransitionSet> {
         }
     };
 
+    // A syntax error found by test(). `position` is the index of the
+    // offending token in the input.
+    struct SyntaxError {
+        size_t position;
+        StateID state;
+        SymbolID lookahead;
+    };
+
     // Store actionTable and gotoTable in the same place.
     // Unfortunately, C++ doesn't have dynamic high-dimensional arrays, so
     // we have to use std::vector instead.
@@ -55,13 +68,36 @@ class LRParser : public util::ResourceProvider<TransitionSet> {
 
     explicit LRParser(const gram::Grammar &g)
         : gram(g), nfa(this, &this->kernelLabelMap),
-          dfa(this, &this->kernelLabelMap) {}
+          dfa(this, &this->kernelLabelMap), treeBuilder(tree, g, true),
+          treeOrigins(g), listenerOrigins(g) {}
+    // Parsers are deleted through base pointers, e.g. in main().
+    virtual ~LRParser() = default;
 
     virtual void buildNFA();
     virtual void buildDFA();
     void buildParseTable();
+    // Prints the number of states and the conflicts of the parse table.
+    void printSummary() const;
     bool test(::std::istream &stream);
 
+    // Reads all symbols up to "$" (or the end of the stream) without parsing
+    // them. "$" is always the last element.
+    [[nodiscard]] std::vector<SymbolID> tokenize(::std::istream &stream) const;
+
+    // Selects the start symbol used by test() and by the drivers built on
+    // this parser. It must be one of the grammar's start symbols.
+    void setEntry(SymbolID entry) { entryState = getStartState(entry); }
+    // DFA state to start from for `entry`. Throws if it's not a start symbol.
+    [[nodiscard]] StateID getStartState(SymbolID entry) const;
+    // DFA state of the selected entry.
+    [[nodiscard]] StateID getStartState() const {
+        return entryState >= 0 ? entryState : dfa.getStartState();
+    }
+
+    // Attach a listener which receives shift and reduce events in test(), e.g.
+    // a SemanticStack. Pass nullptr to detach. The listener is not owned.
+    void setListener(ParseListener *l) { listener = l; }
+
     // Accessors
     [[nodiscard]] auto const &getParseTable() const { return parseTable; }
     [[nodiscard]] auto const &getGrammar() const { return gram; }
@@ -70,7 +106,30 @@ class LRParser : public util::ResourceProvider<TransitionSet> {
     [[nodiscard]] auto const &getStateStack() const { return stateStack; }
     [[nodiscard]] auto const &getInputQueue() const { return InputQueue; }
     [[nodiscard]] auto const &getSymbolStack() const { return symbolStack; }
+    // Concrete syntax tree built by the last call to test().
+    [[nodiscard]] auto const &getSyntaxTree() const { return tree; }
     [[nodiscard]] bool hasMoreInput() const { return inputFlag; }
+    // Errors reported by the last call to test().
+    [[nodiscard]] auto const &getSyntaxErrors() const { return syntaxErrors; }
+
+    // Terminals (including "$") with a non-error action in `state`. Built in
+    // buildParseTable().
+    [[nodiscard]] auto const &getExpectedTerminals(StateID state) const {
+        return expectedTerminals[state];
+    }
+    // The only action of `state` if it reduces by the same production on
+    // every expected terminal, or -1.
+    [[nodiscard]] ProductionID getDefaultReduction(StateID state) const {
+        return defaultReductions[state];
+    }
+    // Terminals which can follow a live state stack (bottom to top). Default
+    // reductions at the top are followed, so only the terminals which survive
+    // them are returned.
+    [[nodiscard]] util::BitSet<ActionID>
+    getExpectedTerminals(util::Span<StateID const> stack) const;
+    // Names of the terminals, for messages, e.g. "ID, (".
+    [[nodiscard]] std::string
+    dumpTerminals(util::BitSet<ActionID> const &terms) const;
 
     // Format
     [[nodiscard]] std::string dumpParseTableEntry(StateID state,
@@ -80,32 +139,72 @@ class LRParser : public util::ResourceProvider<TransitionSet> {
     // With this interface automatons can get transition resources whose
     // lifetime can be longer than itself.
     TransitionSet *requestResource() override {
-        transitionSetPool.push_back(std::make_unique<TransitionSet>());
-        return transitionSetPool.back().get();
+        return &transitionSetPool.emplace_back(transitionArena);
+    }
+
+    // Arenas which hold the automata, for statistics.
+    [[nodiscard]] auto const &getBlockArena() const { return blockArena; }
+    [[nodiscard]] auto const &getTransitionArena() const {
+        return transitionArena;
     }
+    [[nodiscard]] auto const &getLabelArena() const { return labelArena; }
 
   protected:
     bool inputFlag = true;
-    // PDA final state ID (not closure ID). Used to put SUCCESS entry. Assigned
-    // in buildNFA(). Since LALR uses a different building method, this should
-    // be assigned in LALR's buildDFA().
-    StateID auxEnd{-1};
+    ParseListener *listener = nullptr;
+    // PDA final state IDs (not closure IDs), one per start symbol. Used to put
+    // SUCCESS entries. Assigned in buildNFA(). Since LALR uses a different
+    // building method, these should be assigned in LALR's buildDFA().
+    std::vector<StateID> auxEnds;
+    // Start state selected by setEntry(), or -1 for the default one.
+    StateID entryState{-1};
     const gram::Grammar &gram;
+    // Storage of BitSet blocks, transitions and labels built by this parser.
+    // They are declared before everything allocated from them, so they are
+    // destroyed last, and release their memory in a few calls to free().
+    // BitSets use `blockArena` inside the build methods, which install it
+    // with a util::BlockArena::Scope.
+    util::BlockArena blockArena;
+    util::Arena transitionArena;
+    util::Arena labelArena;
     PushDownAutomaton nfa; // Built in buildNFA()
     PushDownAutomaton dfa; // Built in buildDFA()
     ParseTable parseTable; // Built in buildParseTable()
     std::deque<SymbolID> InputQueue;
     std::vector<StateID> stateStack;
     std::vector<SymbolID> symbolStack;
-    std::vector<int> astNodeStack;
+    std::vector<SyntaxError> syntaxErrors;
+    // Index of the token at the front of the input queue.
+    size_t inputPosition = 0;
+    // Same as yacc's "errflag": the number of tokens to shift before new
+    // errors are reported again. It's 3 right after recovery.
+    int errorStatus = 0;
+    SyntaxTree tree;
+    // Builds `tree` during test(), and narrates it to the step trace.
+    CSTBuilder treeBuilder;
+    // If the grammar is transformed, events reach the tree builder and the
+    // listener through these, so they see the original productions.
+    OriginListener treeOrigins;
+    OriginListener listenerOrigins;
+    // Receivers of the events of test(). Chosen when it starts.
+    ParseListener *treeSink = &treeBuilder;
+    ParseListener *listenerSink = nullptr;
     // Fetch kernel label by productionID and rhsIndex.
     // The shape of this map (not square) is important to the following process.
-    // The last production is S' -> S, which is added automatically.
+    // The last productions are S' -> S for each start symbol, which are added
+    // automatically.
     std::vector<std::vector<const char *>> kernelLabelMap;
-    std::vector<std::unique_ptr<Constraint>> constraintPool;
-    std::vector<std::unique_ptr<char[]>> stringPool;
-    std::vector<std::unique_ptr<TransitionSet>> transitionSetPool;
+    // Deques never move their elements, so the pointers handed out stay
+    // valid.
+    std::deque<Constraint> constraintPool;
+    std::deque<TransitionSet> transitionSetPool;
     std::set<std::pair<int, int>> parseTableConflicts;
+    // Cells emptied by %nonassoc, so the input is rejected there.
+    std::set<std::pair<int, int>> nonassocErrors;
+    size_t resolvedConflicts = 0;
+    // Indexed by state. Built in buildParseTable().
+    std::vector<util::BitSet<ActionID>> expectedTerminals;
+    std::vector<ProductionID> defaultReductions;
     // Contains all non-epsilon terminals. Built in buildKernel().
     Constraint *allTermConstraint = nullptr;
 
@@ -115,35 +214,30 @@ class LRParser : public util::ResourceProvider<TransitionSet> {
     // Creates a new constraint and store it in the pool.
     // Returns the pointer to the stored constraint.
     Constraint *newConstraint(size_t size) {
-        constraintPool.push_back(
-            std::make_unique<Constraint>(size));
-        return constraintPool.back().get();
+        return &constraintPool.emplace_back(size);
     }
 
     // Stores an existing constraint in the pool.
     // Returns the pointer to the stored constraint.
     Constraint *newConstraint(Constraint constraints) {
-        constraintPool.push_back(
-            std::make_unique<Constraint>(std::move(constraints)));
-        return constraintPool.back().get();
+        return &constraintPool.emplace_back(std::move(constraints));
     }
 
     // Copies a string, and stores it the pool.
     // Returns the pointer to the stored C-style string.
     const char *newString(std::string const &s) {
-        auto holder = std::make_unique<char[]>(s.size() + 1);
-        char *buf = holder.get();
-        strcpy(buf, s.c_str());
-        stringPool.push_back(std::move(holder));
+        char *buf = labelArena.allocateArray<char>(s.size() + 1);
+        memcpy(buf, s.c_str(), s.size() + 1);
         return buf;
     }
 
     // The returned resource should be allocated by newConstraint(), which
     // keeps the resource available until parser is destroyed.
-    // Argument `parentConstraint` may be nullptr.
+    // Argument `parentConstraint` may be nullptr. Augmented productions
+    // "S' -> S" have IDs from the size of the production table.
     virtual Constraint *
     resolveLocalConstraints(Constraint const *parentConstraint,
-                            Production const &production, int rhsIndex) = 0;
+                            ProductionID prodID, int rhsIndex) = 0;
 
     // Whether the automaton states should contain constraints (lookaheads) in
     // their labels. Default: LR0 (ignore constraints).
@@ -171,13 +265,35 @@ class LRParser : public util::ResourceProvider<TransitionSet> {
     // This is only used inside test() method.
     void readSymbol(util::TokenReader &reader);
 
+    // Checks that `s` is a symbol which can appear in the input, and returns
+    // its ID.
+    [[nodiscard]] SymbolID toInputSymbol(std::string const &s) const;
+
     // Creates the table if it does not exist, and add an entry to
     // it.
     void addParseTableEntry(StateID state, ActionID act, ParseAction pact);
 
+    // Settles a shift/reduce conflict between `pact` and the entry in the
+    // cell with the precedences declared in the grammar, like yacc does.
+    // Returns false if they don't decide it.
+    bool resolveByPrecedence(StateID state, ActionID act, ParseAction pact);
+
+    // Fills expectedTerminals and defaultReductions from the parse table.
+    void buildExpectedTerminals();
+
     // Try to apply reduction by production with the given ID. Throws an error
     // if reduction fails.
-    void reduce(ProductionID prodID, int astNodeIndex);
+    void reduce(ProductionID prodID);
+
+    // Pops the top `count` states and symbols, and tells listeners.
+    void popStack(size_t count);
+
+    // Called when no action exists for the current lookahead. Records the
+    // error, and recovers yacc-style if the grammar uses the "error" token:
+    // pop states until one can shift "error", shift it, and then discard
+    // tokens until parsing can go on. Returns false if the parse should
+    // stop.
+    bool recover();
 };
 
 } // namespace gram
@@ -0,0 +1,103 @@
+#ifndef LRPARSER_ORIGIN_LISTENER_H
+#define LRPARSER_ORIGIN_LISTENER_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+#include "src/parser/ParseListener.h"
+
+namespace gram {
+
+// Forwards the events of a parser built from a transformed grammar to a
+// listener, as if the parser was built from the original grammar. See
+// Grammar::transform().
+//
+// A reduction is replaced by the original reductions it stands for. Values
+// of synthetic symbols made by left-factoring are not reported: their
+// children stay on the target's stack until the symbol itself is reduced.
+// So a parser stack entry may stand for several entries of the target, and
+// their numbers are kept here to translate onDiscard().
+class OriginListener : public ParseListener {
+  public:
+    explicit OriginListener(Grammar const &g) : gram(g) {
+        entries.reserve(64);
+    }
+
+    // The listener which receives translated events, or nullptr.
+    void setTarget(ParseListener *l) { target = l; }
+    [[nodiscard]] ParseListener *getTarget() const { return target; }
+
+    void onStart() override {
+        entries.clear();
+        if (target)
+            target->onStart();
+    }
+
+    void onShift(SymbolID token) override {
+        entries.push_back({1, ProductionID{-1}});
+        if (target)
+            target->onShift(token);
+    }
+
+    void onReduce(ProductionID prodID, SymbolID head,
+                  size_t bodySize) override {
+        assert(entries.size() >= bodySize);
+        auto first = entries.size() - bodySize;
+        int width = 0;
+        for (auto i = first; i < entries.size(); ++i)
+            width += entries[i].width;
+        // A production ending with a synthetic symbol gets its reductions
+        // from the production which was reduced to that symbol.
+        auto source = prodID;
+        auto const &rhs = gram.getProductionTable()[prodID].rightSymbols;
+        if (!rhs.empty() && gram.getAllSymbols()[rhs.back()].synthetic)
+            source = entries.back().source;
+        entries.resize(first);
+
+        if (gram.getAllSymbols()[head].synthetic) {
+            entries.push_back({width, source});
+            return;
+        }
+        if (target)
+            for (auto const &r : gram.getOrigins(source))
+                target->onReduce(r.prodID, r.head,
+                                 static_cast<size_t>(r.bodySize));
+        entries.push_back({1, ProductionID{-1}});
+    }
+
+    void onDiscard(size_t count) override {
+        assert(entries.size() >= count);
+        size_t width = 0;
+        for (auto i = entries.size() - count; i < entries.size(); ++i)
+            width += static_cast<size_t>(entries[i].width);
+        entries.resize(entries.size() - count);
+        if (target)
+            target->onDiscard(width);
+    }
+
+    void onAccept() override {
+        if (target)
+            target->onAccept();
+    }
+
+  private:
+    // A parser stack entry.
+    struct Entry {
+        // Number of entries of the target.
+        int width;
+        // For synthetic symbols: the production whose origins are reported
+        // when the symbol is reduced.
+        ProductionID source;
+    };
+
+    Grammar const &gram;
+    ParseListener *target = nullptr;
+    std::vector<Entry> entries;
+};
+
+} // namespace gram
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef LRPARSER_PARSE_LISTENER_H
+#define LRPARSER_PARSE_LISTENER_H
+
+#include <cstddef>
+
+#include "src/common.h"
+
+namespace gram {
+
+// Receives events from a parse driver, so results other than the step trace
+// can be built while parsing.
+//
+// The events are those of a bottom-up parse, in order. A listener that pushes
+// one entry per onShift() and replaces the top `bodySize` entries with one per
+// onReduce() stays in step with the state stack of an LR driver (except its
+// bottom state). Nothing is promised about when a driver updates its own
+// stacks relative to the calls, and drivers without a state stack, like
+// LLParser, report the same events. The "error" token is reported through
+// onShift() like any other token.
+struct ParseListener {
+    // Called once before a new parse starts.
+    virtual void onStart() {}
+    virtual void onShift(SymbolID token) = 0;
+    virtual void onReduce(ProductionID prodID, SymbolID head,
+                          size_t bodySize) = 0;
+    // Called when error recovery pops `count` entries from the stack.
+    virtual void onDiscard(size_t count) = 0;
+    // Called when the input is accepted.
+    virtual void onAccept() {}
+    virtual ~ParseListener() = default;
+};
+
+} // namespace gram
+
+#endif
@@ -0,0 +1,85 @@
+#include "src/parser/ParseSession.h"
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+
+namespace gram {
+
+using ParseAction = LRParser::ParseAction;
+
+void ParseSession::reset() {
+    stateStack.clear();
+    stateStack.push_back(startState);
+    status = NEED_MORE;
+    position = 0;
+    errorToken = SymbolID{-1};
+    if (listener)
+        listener->onStart();
+}
+
+bool ParseSession::reduce(ProductionID prodID) {
+    auto const &prod = lr->getGrammar().getProductionTable()[prodID];
+    auto bodySize = prod.rightSymbols.size();
+    if (stateStack.size() <= bodySize)
+        return false;
+    stateStack.resize(stateStack.size() - bodySize);
+    if (listener)
+        listener->onReduce(prodID, prod.leftSymbol, bodySize);
+    for (auto const &pact :
+         lr->getParseTable()[stateStack.back()][prod.leftSymbol]) {
+        if (pact.type == ParseAction::GOTO) {
+            stateStack.push_back(pact.dest);
+            return true;
+        }
+    }
+    return false;
+}
+
+ParseSession::Status ParseSession::feed(SymbolID token) {
+    if (status != NEED_MORE)
+        return status;
+    auto const &g = lr->getGrammar();
+    auto const &symbols = g.getAllSymbols();
+    if (token < 0 || static_cast<size_t>(token) >= symbols.size() ||
+        symbols[token].type != SymbolType::TERM ||
+        (g.hasErrorSymbol() && token == g.getErrorSymbol().id)) {
+        return fail(token);
+    }
+
+    auto const &table = lr->getParseTable();
+    while (true) {
+        auto const &cell = table[stateStack.back()][token];
+        // Conflicts are errors, the same as in LRParser::test().
+        if (cell.size() != 1)
+            return fail(token);
+        auto const &decision = *cell.begin();
+        switch (decision.type) {
+        case ParseAction::REDUCE:
+            if (!reduce(decision.productionID))
+                return fail(token);
+            break;
+        case ParseAction::SHIFT:
+            if (listener)
+                listener->onShift(token);
+            stateStack.push_back(decision.dest);
+            ++position;
+            return status;
+        case ParseAction::SUCCESS:
+            if (listener)
+                listener->onAccept();
+            return status = ACCEPTED;
+        case ParseAction::GOTO:
+            return fail(token);
+        }
+    }
+}
+
+ParseSession::Status ParseSession::feed(util::Span<SymbolID const> tokens) {
+    for (auto token : tokens) {
+        if (feed(token) != NEED_MORE)
+            break;
+    }
+    return status;
+}
+
+} // namespace gram
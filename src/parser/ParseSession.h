@@ -0,0 +1,85 @@
+#ifndef LRPARSER_PARSE_SESSION_H
+#define LRPARSER_PARSE_SESSION_H
+
+#include <memory>
+#include <vector>
+
+#include "src/common.h"
+#include "src/parser/LRParser.h"
+#include "src/parser/OriginListener.h"
+#include "src/parser/ParseListener.h"
+#include "src/util/Span.h"
+
+namespace gram {
+
+// A push parser. Instead of reading from a stream like LRParser::test(), the
+// caller feeds tokens as they arrive, and each call returns as soon as the
+// token is shifted. All parse state lives in the session, so one thread can
+// drive any number of sessions on the same (built) LRParser.
+//
+// Sessions do not write the step trace, and do not recover from errors: the
+// first syntax error ends the session until reset() is called.
+class ParseSession {
+  public:
+    enum Status { NEED_MORE, ACCEPTED, ERROR };
+
+    explicit ParseSession(LRParser const &lr, ParseListener *listener = nullptr)
+        : lr(&lr), listener(listener), startState(lr.getStartState()) {
+        // The listener receives the reductions of the grammar file.
+        if (listener && lr.getGrammar().isTransformed()) {
+            origins = std::make_unique<OriginListener>(lr.getGrammar());
+            origins->setTarget(listener);
+            this->listener = origins.get();
+        }
+        reset();
+    }
+
+    // Starts a new parse.
+    void reset();
+    // Starts a new parse of another start symbol. Later calls to reset() keep
+    // using it.
+    void reset(SymbolID entry) {
+        startState = lr->getStartState(entry);
+        reset();
+    }
+
+    // Takes one token. Feeding "$" ends the input. Once the status is not
+    // NEED_MORE, further tokens are ignored.
+    Status feed(SymbolID token);
+
+    // Takes tokens in order, and stops early if the status changes.
+    Status feed(util::Span<SymbolID const> tokens);
+
+    [[nodiscard]] Status getStatus() const { return status; }
+    // Number of tokens shifted.
+    [[nodiscard]] size_t getPosition() const { return position; }
+    [[nodiscard]] auto const &getStateStack() const { return stateStack; }
+    // Lookahead which caused the error, or -1.
+    [[nodiscard]] SymbolID getErrorToken() const { return errorToken; }
+    // Terminals which can be fed next, e.g. for completion. After an error,
+    // the ones which were expected instead of the error token.
+    [[nodiscard]] util::BitSet<ActionID> getExpectedTerminals() const {
+        return lr->getExpectedTerminals(stateStack);
+    }
+
+  private:
+    LRParser const *lr;
+    ParseListener *listener;
+    std::unique_ptr<OriginListener> origins;
+    StateID startState;
+    std::vector<StateID> stateStack;
+    Status status = NEED_MORE;
+    size_t position = 0;
+    SymbolID errorToken{-1};
+
+    // Returns false if the goto entry is missing.
+    bool reduce(ProductionID prodID);
+    Status fail(SymbolID token) {
+        errorToken = token;
+        return status = ERROR;
+    }
+};
+
+} // namespace gram
+
+#endif
@@ -11,11 +11,16 @@ class SLRParser : public LRParser {
   protected:
     [[nodiscard]] Constraint *
     resolveLocalConstraints(const Constraint *parentConstraint,
-                            const Production &production,
+                            ProductionID prodID,
                             int rhsIndex) override {
-        auto symbolID = production.rightSymbols[rhsIndex];
+        // The only symbol of "S' -> S" is the start symbol.
+        auto const &productionTable = gram.getProductionTable();
+        auto symbolID =
+            prodID < (int)productionTable.size()
+                ? productionTable[prodID].rightSymbols[rhsIndex]
+                : gram.getStartSymbols()[prodID - productionTable.size()];
         auto const &symbols = gram.getAllSymbols();
-        auto res = newConstraint(symbols[symbolID].followSet);
+        auto res = newConstraint(Constraint(symbols[symbolID].followSet));
         // Ignore parentConstraint
         return res;
     }
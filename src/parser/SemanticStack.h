@@ -0,0 +1,125 @@
+#ifndef LRPARSER_SEMANTIC_STACK_H
+#define LRPARSER_SEMANTIC_STACK_H
+
+#include <cassert>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+#include "src/parser/ParseListener.h"
+#include "src/util/Span.h"
+
+namespace gram {
+
+// A typed value stack which runs alongside the parser's state stack. Every
+// shifted token gets a value from the shift action, and every reduction
+// replaces the values of the handle with the value returned by the reduce
+// action registered for that production.
+//
+// Values are only moved. Children are passed as a mutable span, so a reduce
+// action may move them out; the remains are destroyed after the action
+// returns. Once the stack has grown to the maximum parse depth, reductions
+// do not allocate.
+template <class V> class SemanticStack : public ParseListener {
+  public:
+    using value_type = V;
+    using ShiftAction = std::function<V(SymbolID token)>;
+    using ReduceAction = std::function<V(util::Span<V> children)>;
+
+    static_assert(std::is_move_constructible_v<V> &&
+                      std::is_move_assignable_v<V>,
+                  "Semantic values must be movable");
+
+    // Reduce actions are registered for the productions of the grammar file,
+    // even if the grammar is transformed.
+    explicit SemanticStack(Grammar const &g)
+        : reduceActions(g.getOriginalProductions().size()) {
+        values.reserve(64);
+    }
+
+    void setShiftAction(ShiftAction action) { shiftAction = std::move(action); }
+
+    void setReduceAction(ProductionID prodID, ReduceAction action) {
+        reduceActions.at(prodID) = std::move(action);
+    }
+
+    // Pre-allocates room for `depth` values.
+    void reserve(size_t depth) { values.reserve(depth); }
+
+    void onStart() override { values.clear(); }
+
+    void onShift(SymbolID token) override {
+        if (shiftAction) {
+            values.push_back(shiftAction(token));
+        } else {
+            values.push_back(makeDefault("shift"));
+        }
+    }
+
+    void onReduce(ProductionID prodID, SymbolID /*head*/,
+                  size_t bodySize) override {
+        assert(values.size() >= bodySize);
+        auto first = values.size() - bodySize;
+        util::Span<V> children(values.data() + first, bodySize);
+        auto const &action = reduceActions[prodID];
+        V result = action ? action(children) : defaultReduce(children);
+        // erase() only needs move assignment, and keeps the capacity.
+        values.erase(values.begin() + static_cast<std::ptrdiff_t>(first),
+                     values.end());
+        values.push_back(std::move(result));
+    }
+
+    void onDiscard(size_t count) override {
+        assert(values.size() >= count);
+        values.erase(values.end() - static_cast<std::ptrdiff_t>(count),
+                     values.end());
+    }
+
+    [[nodiscard]] size_t size() const { return values.size(); }
+    [[nodiscard]] bool empty() const { return values.empty(); }
+    [[nodiscard]] V &top() { return values.back(); }
+    [[nodiscard]] V const &top() const { return values.back(); }
+
+    // Moves the value on top of the stack out. After a successful parse, this
+    // is the value of the start symbol.
+    V takeResult() {
+        if (values.empty()) {
+            throw std::runtime_error("SemanticStack: No value to take");
+        }
+        V result = std::move(values.back());
+        values.pop_back();
+        return result;
+    }
+
+  private:
+    std::vector<V> values;
+    ShiftAction shiftAction;
+    std::vector<ReduceAction> reduceActions;
+
+    static V makeDefault(const char *what) {
+        if constexpr (std::is_default_constructible_v<V>) {
+            return V{};
+        } else {
+            throw std::runtime_error(
+                std::string("SemanticStack: No ") + what +
+                " action, and the value type has no default value");
+        }
+    }
+
+    // Same as yacc's "$$ = $1".
+    static V defaultReduce(util::Span<V> children) {
+        if (!children.empty()) {
+            return std::move(children.front());
+        }
+        return makeDefault("reduce");
+    }
+};
+
+} // namespace gram
+
+#endif
@@ -0,0 +1,341 @@
+#include "src/parser/SpeculativeParser.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "src/common.h"
+#include "src/grammar/Grammar.h"
+
+namespace gram {
+
+using ParseAction = LRParser::ParseAction;
+
+SpeculativeParser::SpeculativeParser(LRParser const &lr)
+    : startState(lr.getStartState()),
+      endOfInput(lr.getGrammar().getEndOfInputSymbol().id) {
+    auto const &g = lr.getGrammar();
+    if (g.isTransformed()) {
+        throw std::runtime_error(
+            "Speculative parsing does not support --transform");
+    }
+    auto const &parseTable = lr.getParseTable();
+    auto states = parseTable.size();
+    columns = states ? parseTable[0].size() : 0;
+
+    for (auto const &prod : g.getProductionTable()) {
+        bodySizes.push_back(static_cast<int>(prod.rightSymbols.size()));
+        heads.push_back(prod.leftSymbol);
+    }
+
+    table.resize(states * columns, Action{Action::ERROR, 0});
+    shiftStates.resize(columns);
+    predecessors.resize(states);
+    for (size_t s = 0; s < states; ++s) {
+        for (size_t sym = 0; sym < columns; ++sym) {
+            auto const &cell = parseTable[s][sym];
+            if (cell.size() != 1)
+                continue;
+            auto const &pact = *cell.begin();
+            auto &action = table[s * columns + sym];
+            action.data = pact.untyped_data;
+            switch (pact.type) {
+            case ParseAction::SHIFT:
+                action.type = Action::SHIFT;
+                shiftStates[sym].push_back(StateID(s));
+                break;
+            case ParseAction::GOTO:
+                action.type = Action::GOTO;
+                break;
+            case ParseAction::REDUCE:
+                action.type = Action::REDUCE;
+                break;
+            case ParseAction::SUCCESS:
+                action.type = Action::SUCCESS;
+                break;
+            }
+            // Every state has one accessing symbol, so each predecessor is
+            // listed once.
+            if (action.type == Action::SHIFT || action.type == Action::GOTO)
+                predecessors[pact.dest].push_back(StateID(s));
+        }
+    }
+}
+
+SpeculativeParser::Outcome
+SpeculativeParser::run(std::vector<StateID> &stack,
+                       util::Span<SymbolID const> tokens, size_t &pos,
+                       size_t end) const {
+    while (true) {
+        auto const &action = actionOf(stack.back(), tokens[pos]);
+        switch (action.type) {
+        case Action::SHIFT:
+            if (pos == end)
+                return REACHED;
+            stack.push_back(StateID(action.data));
+            ++pos;
+            break;
+        case Action::REDUCE: {
+            auto bodySize = static_cast<size_t>(bodySizes[action.data]);
+            if (stack.size() <= bodySize)
+                return FAILED;
+            stack.resize(stack.size() - bodySize);
+            auto const &next = actionOf(stack.back(), heads[action.data]);
+            if (next.type != Action::GOTO)
+                return FAILED;
+            stack.push_back(StateID(next.data));
+            break;
+        }
+        case Action::SUCCESS:
+            return ACCEPTED;
+        default:
+            return FAILED;
+        }
+    }
+}
+
+SpeculativeParser::Outcome
+SpeculativeParser::step(std::vector<Fork> &forks, size_t i, SymbolID token,
+                        bool atEnd, size_t maxGuesses) const {
+    // forks[i] is looked up again after each push_back.
+    while (true) {
+        auto const &action = actionOf(forks[i].stack.back(), token);
+        switch (action.type) {
+        case Action::SHIFT:
+            if (atEnd)
+                return REACHED;
+            forks[i].stack.push_back(StateID(action.data));
+            return RUNNING;
+        case Action::REDUCE: {
+            auto bodySize = static_cast<size_t>(bodySizes[action.data]);
+            // Guess the states below the handle. The copies redo this
+            // reduction when their turn comes.
+            while (forks[i].stack.size() <= bodySize) {
+                auto const &preds = predecessors[forks[i].stack.front()];
+                if (preds.empty() || forks[i].recent++ == maxGuesses)
+                    return FAILED;
+                for (size_t k = 1; k < preds.size(); ++k) {
+                    Fork copy = forks[i];
+                    copy.stack.insert(copy.stack.begin(), preds[k]);
+                    for (auto &expect : copy.expects)
+                        expect.insert(expect.begin(), preds[k]);
+                    ++copy.guesses;
+                    forks.push_back(std::move(copy));
+                }
+                auto &fork = forks[i];
+                fork.stack.insert(fork.stack.begin(), preds[0]);
+                for (auto &expect : fork.expects)
+                    expect.insert(expect.begin(), preds[0]);
+                ++fork.guesses;
+            }
+            auto &stack = forks[i].stack;
+            stack.resize(stack.size() - bodySize);
+            auto const &next = actionOf(stack.back(), heads[action.data]);
+            if (next.type != Action::GOTO)
+                return FAILED;
+            stack.push_back(StateID(next.data));
+            break;
+        }
+        case Action::SUCCESS:
+            return ACCEPTED;
+        default:
+            return FAILED;
+        }
+    }
+}
+
+std::vector<SpeculativeParser::Fork>
+SpeculativeParser::speculate(util::Span<SymbolID const> tokens, size_t begin,
+                             size_t end, Options const &options,
+                             size_t &work) const {
+    std::vector<Fork> done;
+    std::vector<Fork> forks;
+    std::vector<Fork> next;
+    for (auto state : shiftStates[tokens[begin]])
+        forks.push_back(Fork{{state}, {{state}}, 1, begin});
+
+    // All forks move in lockstep, so the ones with the same stack can be
+    // merged after each token.
+    for (auto pos = begin; !forks.empty() && pos <= end; ++pos) {
+        auto atEnd = pos == end;
+        for (auto &fork : forks)
+            fork.recent = 0;
+        for (size_t i = 0; i < forks.size(); ++i) {
+            auto outcome =
+                step(forks, i, tokens[pos], atEnd, options.maxGuesses);
+            forks[i].outcome = outcome;
+        }
+
+        next.clear();
+        for (auto &fork : forks) {
+            if (fork.outcome == FAILED)
+                continue;
+            if (fork.outcome != RUNNING) {
+                fork.end = pos;
+                done.push_back(std::move(fork));
+                continue;
+            }
+            fork.end = pos + 1;
+            ++work;
+            auto same = std::find_if(
+                next.begin(), next.end(), [&fork](Fork const &other) {
+                    return other.stack == fork.stack;
+                });
+            if (same == next.end()) {
+                next.push_back(std::move(fork));
+                continue;
+            }
+            for (auto &expect : fork.expects) {
+                if (std::find(same->expects.begin(), same->expects.end(),
+                              expect) == same->expects.end())
+                    same->expects.push_back(std::move(expect));
+            }
+            same->guesses = std::min(same->guesses, fork.guesses);
+            if (same->expects.size() > options.maxExpects) {
+                std::stable_sort(same->expects.begin(), same->expects.end(),
+                                 [](std::vector<StateID> const &a,
+                                    std::vector<StateID> const &b) {
+                                     return a.size() < b.size();
+                                 });
+                same->expects.resize(options.maxExpects);
+            }
+        }
+        forks.swap(next);
+
+        if (forks.size() > options.maxForks) {
+            std::stable_sort(forks.begin(), forks.end(),
+                             [](Fork const &a, Fork const &b) {
+                                 return a.guesses < b.guesses;
+                             });
+            forks.erase(forks.begin() +
+                            static_cast<std::ptrdiff_t>(options.maxForks),
+                        forks.end());
+        }
+    }
+    return done;
+}
+
+void SpeculativeParser::checkInput(util::Span<SymbolID const> tokens) const {
+    if (tokens.empty() || tokens.back() != endOfInput) {
+        throw std::runtime_error("Input of the parser should end with $");
+    }
+    for (auto token : tokens) {
+        if (token < 0 || static_cast<size_t>(token) >= columns)
+            throw std::runtime_error("Input has an unknown symbol");
+    }
+}
+
+std::vector<size_t>
+SpeculativeParser::findCuts(util::Span<SymbolID const> tokens, size_t parts,
+                            Options const &options) const {
+    std::vector<size_t> cuts{0};
+    auto n = tokens.size();
+    for (size_t i = 1; i < parts; ++i) {
+        auto from = std::max(i * n / parts, cuts.back() + 1);
+        auto to = std::min(from + options.window, n - 1);
+        size_t best = 0;
+        size_t bestCount = options.maxCandidates + 1;
+        for (size_t pos = from; pos < to && bestCount > 1; ++pos) {
+            auto count = shiftStates[tokens[pos]].size();
+            if (count > 0 && count < bestCount) {
+                best = pos;
+                bestCount = count;
+            }
+        }
+        if (bestCount <= options.maxCandidates)
+            cuts.push_back(best);
+    }
+    return cuts;
+}
+
+bool SpeculativeParser::parseSequential(util::Span<SymbolID const> tokens) {
+    checkInput(tokens);
+    chunks = 1;
+    speculated = 0;
+    errorPosition = -1;
+    std::vector<StateID> stack{startState};
+    size_t pos = 0;
+    auto outcome = run(stack, tokens, pos, tokens.size());
+    sequential = pos;
+    if (outcome == ACCEPTED)
+        return true;
+    errorPosition = static_cast<long long>(pos);
+    return false;
+}
+
+bool SpeculativeParser::parse(util::Span<SymbolID const> tokens,
+                              Options const &options) {
+    checkInput(tokens);
+    auto threads = options.threads ? options.threads
+                                   : std::thread::hardware_concurrency();
+    if (threads <= 1 || tokens.size() / threads < options.minChunk)
+        return parseSequential(tokens);
+
+    auto cuts = findCuts(tokens, threads, options);
+    chunks = cuts.size();
+    cuts.push_back(tokens.size());
+    errorPosition = -1;
+
+    // results[i] holds the forks of chunk i.
+    std::vector<std::vector<Fork>> results(chunks);
+    std::vector<size_t> work(chunks);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks; ++i) {
+        workers.emplace_back([&, i] {
+            results[i] =
+                speculate(tokens, cuts[i], cuts[i + 1], options, work[i]);
+        });
+    }
+
+    // The first chunk is parsed for real meanwhile.
+    std::vector<StateID> stack{startState};
+    size_t pos = 0;
+    auto outcome = run(stack, tokens, pos, cuts[1]);
+    sequential = pos;
+
+    for (auto &worker : workers)
+        worker.join();
+    speculated = 0;
+    for (auto w : work)
+        speculated += w;
+
+    for (size_t i = 1; i < chunks && outcome == REACHED; ++i) {
+        auto begin = pos;
+        Fork const *match = nullptr;
+        size_t replaced = 0;
+        for (auto const &fork : results[i]) {
+            for (auto const &expect : fork.expects) {
+                if (expect.size() <= stack.size() &&
+                    std::equal(expect.begin(), expect.end(),
+                               stack.end() - static_cast<std::ptrdiff_t>(
+                                                 expect.size()))) {
+                    match = &fork;
+                    replaced = expect.size();
+                    break;
+                }
+            }
+            if (match)
+                break;
+        }
+        // Any fork whose guesses hold did what the real parse would do.
+        if (match) {
+            stack.resize(stack.size() - replaced);
+            stack.insert(stack.end(), match->stack.begin(),
+                         match->stack.end());
+            pos = match->end;
+            outcome = match->outcome;
+            continue;
+        }
+        // Finish the chunk sequentially.
+        outcome = run(stack, tokens, pos, cuts[i + 1]);
+        sequential += pos - begin;
+    }
+
+    if (outcome == ACCEPTED)
+        return true;
+    errorPosition = static_cast<long long>(pos);
+    return false;
+}
+
+} // namespace gram
@@ -0,0 +1,141 @@
+#ifndef LRPARSER_SPECULATIVE_H
+#define LRPARSER_SPECULATIVE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "src/common.h"
+#include "src/parser/LRParser.h"
+#include "src/util/Span.h"
+
+namespace gram {
+
+// Experimental parallel recognizer for one large input.
+//
+// The input is cut into one chunk per thread. Each cut is moved to a nearby
+// synchronization point: a token which can be shifted by as few states as
+// possible. Every chunk except the first is then parsed speculatively from
+// each of those states, with the states below unknown. When a reduction pops
+// below the known part of the stack, the missing state must be a predecessor
+// (in the DFA) of the bottom state, and the speculation forks once per
+// predecessor. Each fork records the states it assumed as requirements.
+// Forks whose stacks become identical have the same future, so they are
+// merged and keep all of their requirements. Recursive rules make the number
+// of guesses unbounded, so only the forks with the fewest guessed states are
+// kept, and a merged fork only keeps its shortest requirements: each level of
+// nesting doubles them. Usually a cut is at a shallow nesting level anyway.
+//
+// Afterwards the chunks are stitched in order: the real stack at the start of
+// a chunk selects the fork whose requirements it meets, and that fork's stack
+// replaces them. If no fork matches, the chunk is parsed by the sequential
+// driver, so the result is always the same as a sequential parse.
+//
+// Only acceptance is computed; no tree or semantic values are built.
+class SpeculativeParser {
+  public:
+    struct Options {
+        // 0: use the number of hardware threads.
+        size_t threads = 0;
+        // Cuts with more possible states than this are dropped.
+        size_t maxCandidates = 4;
+        // Number of forks kept after each token.
+        size_t maxForks = 8;
+        // Forks guessing more states than this for one token are dropped.
+        size_t maxGuesses = 32;
+        // Merged forks keep only this many of their shortest expects.
+        size_t maxExpects = 16;
+        // Number of tokens searched after a nominal cut.
+        size_t window = 4096;
+        // Inputs with less tokens per thread are parsed sequentially.
+        size_t minChunk = 1 << 16;
+    };
+
+    // Like the other drivers without listeners, it does not support a
+    // transformed grammar.
+    explicit SpeculativeParser(LRParser const &lr);
+
+    // `tokens` should end with "$". Returns true if the input is accepted.
+    bool parse(util::Span<SymbolID const> tokens, Options const &options);
+    bool parse(util::Span<SymbolID const> tokens) {
+        return parse(tokens, Options{});
+    }
+    // Same driver, run on one thread without speculation.
+    bool parseSequential(util::Span<SymbolID const> tokens);
+
+    // Statistics of the last parse.
+    [[nodiscard]] size_t getChunks() const { return chunks; }
+    // Tokens parsed by speculations, counted once per fork.
+    [[nodiscard]] size_t getSpeculatedTokens() const { return speculated; }
+    // Tokens parsed sequentially while stitching.
+    [[nodiscard]] size_t getSequentialTokens() const { return sequential; }
+    // Position of the token where parsing failed, or -1.
+    [[nodiscard]] long long getErrorPosition() const { return errorPosition; }
+
+  private:
+    // A flattened parse table. Conflicting cells are errors.
+    struct Action {
+        enum Type : std::uint8_t { ERROR, SHIFT, REDUCE, GOTO, SUCCESS };
+        Type type;
+        int data;
+    };
+    enum Outcome { RUNNING, REACHED, FAILED, ACCEPTED };
+    struct Fork {
+        // Bottom to top. `stack` replaces any of `expects` on the real stack.
+        std::vector<StateID> stack;
+        std::vector<std::vector<StateID>> expects;
+        // Length of the shortest expect.
+        size_t guesses = 0;
+        // States guessed for the current token, including by the forks
+        // this one was copied from.
+        size_t recent = 0;
+        // Position of the next token to shift.
+        size_t end = 0;
+        Outcome outcome = RUNNING;
+    };
+
+    StateID startState;
+    SymbolID endOfInput;
+    size_t columns;
+    std::vector<Action> table;
+    std::vector<int> bodySizes;
+    std::vector<SymbolID> heads;
+    // States with a transition to each state.
+    std::vector<std::vector<StateID>> predecessors;
+    // States which can shift each terminal.
+    std::vector<std::vector<StateID>> shiftStates;
+
+    size_t chunks = 0;
+    size_t speculated = 0;
+    size_t sequential = 0;
+    long long errorPosition = -1;
+
+    [[nodiscard]] Action const &actionOf(StateID state, SymbolID symbol) const {
+        return table[static_cast<size_t>(state) * columns + symbol];
+    }
+
+    // Runs the driver from `pos` until the token at `end` is about to be
+    // shifted.
+    Outcome run(std::vector<StateID> &stack, util::Span<SymbolID const> tokens,
+                size_t &pos, size_t end) const;
+
+    // Reduces forks[i] until it can shift `token`, and shifts it unless
+    // `atEnd`. New forks are appended to `forks`.
+    Outcome step(std::vector<Fork> &forks, size_t i, SymbolID token,
+                 bool atEnd, size_t maxGuesses) const;
+
+    // Parses tokens in [begin, end) from every state which can shift the
+    // first one. Returns the forks that reached the end or accepted.
+    std::vector<Fork> speculate(util::Span<SymbolID const> tokens,
+                                size_t begin, size_t end,
+                                Options const &options, size_t &work) const;
+
+    void checkInput(util::Span<SymbolID const> tokens) const;
+
+    // Picks cuts for `parts` chunks. The first element is always 0.
+    std::vector<size_t> findCuts(util::Span<SymbolID const> tokens,
+                                 size_t parts, Options const &options) const;
+};
+
+} // namespace gram
+
+#endif
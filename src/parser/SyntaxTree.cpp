@@ -0,0 +1,58 @@
+#include "src/parser/SyntaxTree.h"
+
+#include <cstdio>
+#include <string>
+
+#include "src/common.h"
+#include "src/display/steps.h"
+#include "src/grammar/Grammar.h"
+#include "src/util/Formatter.h"
+
+namespace gram {
+
+std::string SyntaxTree::dumpString(Grammar const &g) const {
+    // Nodes have the symbols which listeners receive.
+    auto const &symbols = g.getOriginalSymbols();
+    util::Formatter f;
+    std::string s;
+    visit([&](NodeID node, int depth, int begin) {
+        s.append(static_cast<size_t>(depth) * 2, ' ');
+        s += symbols[col.symbol[node]].name;
+        s += f.formatView(" [%d, %d)", begin, begin + col.width[node]);
+        if (!isLeaf(node))
+            s += f.formatView(" r%d", col.production[node]);
+        s += '\n';
+    });
+    return s;
+}
+
+void SyntaxTree::dump(FILE *stream, Grammar const &g) const {
+    std::string s = dumpString(g);
+    std::fputs(s.c_str(), stream);
+}
+
+void CSTBuilder::onShift(SymbolID token) {
+    bool virtualToken = gram.hasErrorSymbol() &&
+                        token == gram.getErrorSymbol().id;
+    auto node = tree.addLeaf(token, virtualToken ? 0 : 1);
+    nodeStack.push_back(node);
+    if (traceSteps)
+        step::astAddNode(node, gram.getOriginalSymbols()[token].name);
+}
+
+void CSTBuilder::onReduce(ProductionID prodID, SymbolID head,
+                          size_t bodySize) {
+    assert(nodeStack.size() >= bodySize);
+    auto first = nodeStack.size() - bodySize;
+    auto node =
+        tree.addNode(head, prodID, nodeStack.data() + first, bodySize);
+    if (traceSteps) {
+        step::astAddNode(node, gram.getOriginalSymbols()[head].name);
+        for (size_t i = first; i < nodeStack.size(); ++i)
+            step::astSetParent(nodeStack[i], node);
+    }
+    nodeStack.resize(first);
+    nodeStack.push_back(node);
+}
+
+} // namespace gram
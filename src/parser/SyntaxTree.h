@@ -0,0 +1,250 @@
+#ifndef LRPARSER_SYNTAX_TREE_H
+#define LRPARSER_SYNTAX_TREE_H
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "src/common.h"
+#include "src/parser/ParseListener.h"
+#include "src/util/Arena.h"
+
+namespace gram {
+
+class Grammar;
+
+// An in-memory concrete syntax tree. Nodes are stored as a structure of
+// arrays: one flat column per attribute, indexed by node ID. Columns live in
+// an arena and double when they are full, so the whole tree is dropped in
+// O(1) by releasing the arena.
+//
+// Each node stores its width (number of tokens) instead of an absolute token
+// position, so a subtree does not depend on what precedes it. Visitors
+// compute absolute token spans while walking the tree.
+class SyntaxTree {
+  public:
+    using NodeID = int;
+    static constexpr NodeID none = -1;
+
+    explicit SyntaxTree(size_t reservedNodes = 1024)
+        : initialCapacity(reservedNodes ? reservedNodes : 1) {}
+    SyntaxTree(SyntaxTree const &other) = delete;
+    SyntaxTree &operator=(SyntaxTree const &other) = delete;
+    SyntaxTree(SyntaxTree &&other) = default;
+    SyntaxTree &operator=(SyntaxTree &&other) = default;
+
+    // Adds a token node. Tokens which are not read from the input (e.g. the
+    // "error" token) have a width of 0.
+    NodeID addLeaf(SymbolID symbol, int width = 1) {
+        NodeID id = newNode();
+        col.symbol[id] = symbol;
+        col.production[id] = ProductionID{-1};
+        col.width[id] = width;
+        return id;
+    }
+
+    // Adds an interior node, and links the given children (in order) to it.
+    NodeID addNode(SymbolID symbol, ProductionID prodID,
+                   NodeID const *children, size_t childCount) {
+        NodeID id = newNode();
+        col.symbol[id] = symbol;
+        col.production[id] = prodID;
+        int width = 0;
+        NodeID prev = none;
+        for (size_t i = 0; i < childCount; ++i) {
+            NodeID child = children[i];
+            col.parent[child] = id;
+            width += col.width[child];
+            if (prev == none)
+                col.firstChild[id] = child;
+            else
+                col.nextSibling[prev] = child;
+            prev = child;
+        }
+        if (prev != none)
+            col.nextSibling[prev] = none;
+        col.width[id] = width;
+        return id;
+    }
+
+    void setRoot(NodeID node) { root = node; }
+
+    // Puts `by` in the place of `node`, which is left detached, and updates
+    // the widths of the ancestors.
+    void replace(NodeID node, NodeID by) {
+        NodeID parent = col.parent[node];
+        col.parent[by] = parent;
+        col.nextSibling[by] = col.nextSibling[node];
+        if (parent == none) {
+            root = by;
+            return;
+        }
+        NodeID *link = &col.firstChild[parent];
+        while (*link != node)
+            link = &col.nextSibling[*link];
+        *link = by;
+        int delta = col.width[by] - col.width[node];
+        for (; delta && parent != none; parent = col.parent[parent])
+            col.width[parent] += delta;
+    }
+
+    // Restores the links of a node which addNode() gave to a new parent.
+    void setLinks(NodeID n, NodeID parent, NodeID nextSibling) {
+        col.parent[n] = parent;
+        col.nextSibling[n] = nextSibling;
+    }
+
+    // Drops all nodes. Memory is returned in one go.
+    void clear() {
+        arena.release();
+        col = Columns{};
+        count = capacity = 0;
+        root = none;
+    }
+
+    // Accessors
+    [[nodiscard]] NodeID getRoot() const { return root; }
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    [[nodiscard]] SymbolID symbolOf(NodeID n) const { return col.symbol[n]; }
+    [[nodiscard]] NodeID parentOf(NodeID n) const { return col.parent[n]; }
+    [[nodiscard]] int widthOf(NodeID n) const { return col.width[n]; }
+    [[nodiscard]] NodeID firstChildOf(NodeID n) const {
+        return col.firstChild[n];
+    }
+    [[nodiscard]] NodeID nextSiblingOf(NodeID n) const {
+        return col.nextSibling[n];
+    }
+    // Returns -1 for token nodes.
+    [[nodiscard]] ProductionID productionOf(NodeID n) const {
+        return col.production[n];
+    }
+    // Parser state below the node on the stack when it was pushed, or -1 if
+    // it is unknown. Used to decide whether the node can be reused.
+    [[nodiscard]] StateID stateOf(NodeID n) const { return col.state[n]; }
+    void setState(NodeID n, StateID state) { col.state[n] = state; }
+    [[nodiscard]] bool isLeaf(NodeID n) const {
+        return col.production[n] < 0;
+    }
+    [[nodiscard]] size_t memoryUsage() const { return arena.bytes(); }
+
+    // Walks the subtree of `from` (default: root) in pre-order without
+    // allocating. `f(node, depth, tokenBegin)` is called for each node.
+    template <class F> void visit(F &&f, NodeID from = none) const {
+        NodeID node = (from == none) ? root : from;
+        if (node == none)
+            return;
+        int depth = 0;
+        int pos = 0;
+        while (true) {
+            f(node, depth, pos);
+            NodeID child = col.firstChild[node];
+            if (child != none) {
+                node = child;
+                ++depth;
+                continue;
+            }
+            // Leaf or empty interior node: consume its tokens and move on.
+            pos += col.width[node];
+            while (node != from && depth > 0 && col.nextSibling[node] == none) {
+                node = col.parent[node];
+                --depth;
+            }
+            if (depth == 0)
+                return;
+            node = col.nextSibling[node];
+        }
+    }
+
+    // Dumps the tree with one node per line, indented by depth.
+    void dump(FILE *stream, Grammar const &g) const;
+    [[nodiscard]] std::string dumpString(Grammar const &g) const;
+
+  private:
+    struct Columns {
+        SymbolID *symbol = nullptr;
+        ProductionID *production = nullptr;
+        NodeID *parent = nullptr;
+        NodeID *firstChild = nullptr;
+        NodeID *nextSibling = nullptr;
+        int *width = nullptr;
+        StateID *state = nullptr;
+    };
+
+    util::Arena arena;
+    Columns col;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t initialCapacity;
+    NodeID root = none;
+
+    template <class T> void growColumn(T *&column, size_t newCapacity) {
+        T *fresh = arena.allocateArray<T>(newCapacity);
+        if (count)
+            std::memcpy(fresh, column, count * sizeof(T));
+        column = fresh;
+    }
+
+    NodeID newNode() {
+        if (count == capacity) {
+            // Old columns are abandoned in the arena. Since capacity doubles,
+            // they take at most as much memory as the live columns.
+            size_t newCapacity = capacity ? capacity * 2 : initialCapacity;
+            growColumn(col.symbol, newCapacity);
+            growColumn(col.production, newCapacity);
+            growColumn(col.parent, newCapacity);
+            growColumn(col.firstChild, newCapacity);
+            growColumn(col.nextSibling, newCapacity);
+            growColumn(col.width, newCapacity);
+            growColumn(col.state, newCapacity);
+            capacity = newCapacity;
+        }
+        auto id = static_cast<NodeID>(count++);
+        col.parent[id] = none;
+        col.firstChild[id] = none;
+        col.nextSibling[id] = none;
+        col.state[id] = StateID{-1};
+        return id;
+    }
+};
+
+// Builds a SyntaxTree from parse events. Node IDs are given in the order of
+// shifts and reductions, which is the same order used by the step trace, so
+// the builder can also narrate the tree to the GUI.
+class CSTBuilder : public ParseListener {
+  public:
+    CSTBuilder(SyntaxTree &tree, Grammar const &g, bool traceSteps = false)
+        : tree(tree), gram(g), traceSteps(traceSteps) {
+        nodeStack.reserve(64);
+    }
+
+    void onStart() override {
+        tree.clear();
+        nodeStack.clear();
+    }
+    void onShift(SymbolID token) override;
+    void onReduce(ProductionID prodID, SymbolID head,
+                  size_t bodySize) override;
+    // Popped nodes stay in the arena until the tree is cleared.
+    void onDiscard(size_t count) override {
+        nodeStack.resize(nodeStack.size() - count);
+    }
+    void onAccept() override {
+        if (!nodeStack.empty())
+            tree.setRoot(nodeStack.back());
+    }
+
+    [[nodiscard]] SyntaxTree &getTree() { return tree; }
+
+  private:
+    SyntaxTree &tree;
+    Grammar const &gram;
+    bool traceSteps;
+    std::vector<SyntaxTree::NodeID> nodeStack;
+};
+
+} // namespace gram
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef LRPARSER_ALLOC_STATS_H
+#define LRPARSER_ALLOC_STATS_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace util {
+
+// Heap allocations made by the sets in util, for benchmarks. They are only
+// counted in debug builds (without NDEBUG), and stay 0 otherwise.
+struct AllocStats {
+    static inline std::atomic<size_t> bitSetBlocks{0};
+
+    static constexpr bool enabled() {
+#ifdef NDEBUG
+        return false;
+#else
+        return true;
+#endif
+    }
+
+    static void countBitSetBlocks() {
+#ifndef NDEBUG
+        bitSetBlocks.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    static void reset() { bitSetBlocks = 0; }
+};
+
+} // namespace util
+
+#endif
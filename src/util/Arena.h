@@ -0,0 +1,156 @@
+#ifndef LRPARSER_ARENA_H
+#define LRPARSER_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace util {
+
+// A monotonic (bump) allocator. Memory is carved from chunks which grow
+// geometrically, and nothing is returned until release() is called or the
+// arena is destroyed. Objects placed in an arena must be trivially
+// destructible, or their owners must not rely on destructors being run.
+class Arena {
+  public:
+    static constexpr size_t default_chunk_size = 64 * 1024;
+
+    explicit Arena(size_t firstChunkSize = default_chunk_size)
+        : firstChunkSize(firstChunkSize < 64 ? 64 : firstChunkSize),
+          nextChunkSize(this->firstChunkSize) {}
+    Arena(Arena const &other) = delete;
+    Arena &operator=(Arena const &other) = delete;
+
+    Arena(Arena &&other) noexcept { moveFrom(other); }
+
+    Arena &operator=(Arena &&other) noexcept {
+        if (this != &other) {
+            release();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~Arena() { release(); }
+
+    // Returns `size` bytes aligned to `align`, which must be a power of 2.
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        ++requestCount;
+        auto p = alignUp(cur, align);
+        if (!cur || p + size > limit) {
+            grow(size + align);
+            p = alignUp(cur, align);
+        }
+        cur = p + size;
+        bytesUsed += size;
+        return reinterpret_cast<void *>(p);
+    }
+
+    // Uninitialized storage for `n` objects of type T.
+    template <class T> T *allocateArray(size_t n) {
+        return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    template <class T, class... Args> T *create(Args &&...args) {
+        return new (allocate(sizeof(T), alignof(T)))
+            T(std::forward<Args>(args)...);
+    }
+
+    // Frees every chunk. The number of calls to free() is the number of
+    // chunks, which grows logarithmically with the memory used. The arena can
+    // be used again, starting from the first chunk size.
+    void release() {
+        while (head) {
+            Chunk *next = head->next;
+            std::free(head);
+            head = next;
+        }
+        cur = limit = 0;
+        nextChunkSize = firstChunkSize;
+        chunkCount = 0;
+        bytesUsed = 0;
+    }
+
+    // Statistics
+    [[nodiscard]] size_t chunks() const { return chunkCount; }
+    [[nodiscard]] size_t requests() const { return requestCount; }
+    [[nodiscard]] size_t bytes() const { return bytesUsed; }
+
+  private:
+    struct Chunk {
+        Chunk *next;
+    };
+
+    Chunk *head = nullptr;
+    std::uintptr_t cur = 0;
+    std::uintptr_t limit = 0;
+    size_t firstChunkSize = default_chunk_size;
+    size_t nextChunkSize = default_chunk_size;
+    size_t chunkCount = 0;
+    size_t requestCount = 0;
+    size_t bytesUsed = 0;
+
+    static std::uintptr_t alignUp(std::uintptr_t p, size_t align) {
+        return (p + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+    }
+
+    void grow(size_t atLeast) {
+        size_t size = nextChunkSize;
+        while (size < atLeast + sizeof(Chunk))
+            size *= 2;
+        nextChunkSize = size * 2;
+        auto chunk = static_cast<Chunk *>(std::malloc(size));
+        if (!chunk)
+            throw std::bad_alloc();
+        chunk->next = head;
+        head = chunk;
+        cur = reinterpret_cast<std::uintptr_t>(chunk) + sizeof(Chunk);
+        limit = reinterpret_cast<std::uintptr_t>(chunk) + size;
+        ++chunkCount;
+    }
+
+    void moveFrom(Arena &other) {
+        head = std::exchange(other.head, nullptr);
+        cur = std::exchange(other.cur, 0);
+        limit = std::exchange(other.limit, 0);
+        firstChunkSize = other.firstChunkSize;
+        nextChunkSize = other.nextChunkSize;
+        chunkCount = other.chunkCount;
+        requestCount = other.requestCount;
+        bytesUsed = other.bytesUsed;
+    }
+};
+
+// Standard allocator interface over an Arena, for containers which live no
+// longer than the arena. deallocate() does nothing, so a growing vector
+// leaves its old buffers in the arena.
+template <class T> class ArenaAllocator {
+  public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena &arena) noexcept : arena(&arena) {}
+    template <class U>
+    ArenaAllocator(ArenaAllocator<U> const &other) noexcept
+        : arena(other.arena) {}
+
+    T *allocate(size_t n) { return arena->allocateArray<T>(n); }
+    void deallocate(T *, size_t) noexcept {}
+
+    template <class U> bool operator==(ArenaAllocator<U> const &other) const {
+        return arena == other.arena;
+    }
+    template <class U> bool operator!=(ArenaAllocator<U> const &other) const {
+        return arena != other.arena;
+    }
+
+  private:
+    template <class U> friend class ArenaAllocator;
+    Arena *arena;
+};
+
+} // namespace util
+
+#endif
@@ -0,0 +1,139 @@
+#include "src/util/AsyncWriter.h"
+
+#include <string>
+#include <utility>
+
+namespace util {
+
+AsyncWriter::AsyncWriter(FILE *file, size_t bufferSize)
+    : file(file), bufferSize(bufferSize < 64 ? 64 : bufferSize),
+      threaded(std::thread::hardware_concurrency() > 1) {
+    buffer.resize(this->bufferSize);
+    cur = buffer.data();
+    end = cur + buffer.size();
+}
+
+void AsyncWriter::handOff() {
+    auto used = static_cast<size_t>(cur - buffer.data());
+    if (used == 0)
+        return;
+    if (!threaded) {
+        failed |= std::fwrite(buffer.data(), 1, used, file) != used;
+        cur = buffer.data();
+        return;
+    }
+    // The thread is started for the first full buffer, so small files are
+    // written by close() without one.
+    if (!thread.joinable())
+        thread = std::thread(&AsyncWriter::run, this);
+    buffer.resize(used);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        pending.push_back(std::move(buffer));
+        ready.notify_one();
+        // Wait for the thread if all buffers are in flight.
+        drained.wait(lock, [this] {
+            return buffersInUse < max_buffers || !spare.empty();
+        });
+        if (!spare.empty()) {
+            buffer = std::move(spare.back());
+            spare.pop_back();
+        } else {
+            buffer = std::vector<char>();
+            ++buffersInUse;
+        }
+    }
+    buffer.resize(bufferSize);
+    cur = buffer.data();
+    end = cur + buffer.size();
+}
+
+void AsyncWriter::writeSlow(char const *data, size_t size) {
+    while (size) {
+        if (cur == end)
+            handOff();
+        auto n = std::min(size, static_cast<size_t>(end - cur));
+        std::memcpy(cur, data, n);
+        cur += n;
+        data += n;
+        size -= n;
+    }
+}
+
+void AsyncWriter::printf(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+void AsyncWriter::vprintf(const char *fmt, va_list ap) {
+    va_list copy;
+    va_copy(copy, ap);
+    auto room = static_cast<size_t>(end - cur);
+    int n = std::vsnprintf(cur, room, fmt, copy);
+    va_end(copy);
+    if (n < 0)
+        return;
+    auto len = static_cast<size_t>(n);
+    if (len < room) {
+        cur += len;
+        return;
+    }
+    // It did not fit. Retry in an empty buffer, or format it aside if it's
+    // longer than a buffer.
+    handOff();
+    room = static_cast<size_t>(end - cur);
+    if (len < room) {
+        va_copy(copy, ap);
+        std::vsnprintf(cur, room, fmt, copy);
+        va_end(copy);
+        cur += len;
+        return;
+    }
+    std::string s(len + 1, '\0');
+    va_copy(copy, ap);
+    std::vsnprintf(s.data(), s.size(), fmt, copy);
+    va_end(copy);
+    write(s.data(), len);
+}
+
+void AsyncWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        ready.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty())
+            return;
+        auto data = std::move(pending.front());
+        pending.pop_front();
+        lock.unlock();
+        bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        lock.lock();
+        failed |= !ok;
+        spare.push_back(std::move(data));
+        drained.notify_one();
+    }
+}
+
+bool AsyncWriter::close() {
+    if (!file)
+        return !failed;
+    if (thread.joinable()) {
+        handOff();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            ready.notify_one();
+        }
+        thread.join();
+    } else {
+        auto used = static_cast<size_t>(cur - buffer.data());
+        failed |= std::fwrite(buffer.data(), 1, used, file) != used;
+    }
+    failed |= std::fclose(file) != 0;
+    file = nullptr;
+    cur = end = nullptr;
+    return !failed;
+}
+
+} // namespace util
@@ -0,0 +1,118 @@
+#ifndef LRPARSER_ASYNC_WRITER_H
+#define LRPARSER_ASYNC_WRITER_H
+
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// Writes a file from a background thread. Data is appended to a large
+// buffer in memory, and full buffers are handed to the thread, so the caller
+// only waits for the disk if all buffers are in flight.
+//
+// Starting a thread makes malloc and reference counting take their slower,
+// thread-safe paths for the rest of the process, which costs more than it
+// saves for small files and on a single CPU. So the thread is only started
+// when the first buffer is full, and full buffers are written in the
+// caller's thread if there is one CPU.
+//
+// Only one thread may write to a writer.
+class AsyncWriter {
+  public:
+    static constexpr size_t default_buffer_size = 4 << 20;
+    // Buffers in flight at most, including the one being filled.
+    static constexpr size_t max_buffers = 4;
+
+    // Takes over `file`, which is closed by close() or the destructor.
+    explicit AsyncWriter(FILE *file,
+                         size_t bufferSize = default_buffer_size);
+    AsyncWriter(AsyncWriter const &other) = delete;
+    AsyncWriter &operator=(AsyncWriter const &other) = delete;
+    ~AsyncWriter() { close(); }
+
+    void write(void const *data, size_t size) {
+        if (size <= static_cast<size_t>(end - cur)) {
+            std::memcpy(cur, data, size);
+            cur += size;
+        } else {
+            writeSlow(static_cast<char const *>(data), size);
+        }
+    }
+    void write(std::string_view s) { write(s.data(), s.size()); }
+    void put(char ch) {
+        if (cur == end)
+            handOff();
+        *cur++ = ch;
+    }
+    // Variable-length integer: 7 bits per byte, low bits first, and the high
+    // bit set on all bytes but the last. Signed values are zigzag-encoded,
+    // so small negative numbers stay short.
+    void putVarint(std::uint64_t value) {
+        if (static_cast<size_t>(end - cur) < 10)
+            handOff();
+        while (value >= 0x80) {
+            *cur++ = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        *cur++ = static_cast<char>(value);
+    }
+    void putInt(std::int64_t value) {
+        putVarint((static_cast<std::uint64_t>(value) << 1) ^
+                  static_cast<std::uint64_t>(value >> 63));
+    }
+    // Length and bytes.
+    void putString(std::string_view s) {
+        putVarint(s.size());
+        write(s);
+    }
+
+    void printf(const char *fmt, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+    void vprintf(const char *fmt, va_list ap);
+
+    // Writes everything out, stops the thread and closes the file. Returns
+    // false if a write failed.
+    bool close();
+
+  private:
+    FILE *file;
+    size_t bufferSize;
+    bool threaded;
+    // The buffer being filled.
+    std::vector<char> buffer;
+    char *cur = nullptr;
+    char *end = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable drained;
+    // Full buffers waiting for the thread, oldest first.
+    std::deque<std::vector<char>> pending;
+    // Buffers which have been written, to be filled again.
+    std::vector<std::vector<char>> spare;
+    size_t buffersInUse = 1;
+    bool stopping = false;
+    bool failed = false;
+    std::thread thread;
+
+    // Queues the filled part of the buffer and takes an empty one.
+    void handOff();
+    void writeSlow(char const *data, size_t size);
+    void run();
+};
+
+} // namespace util
+
+#endif
@@ -0,0 +1,302 @@
+#include "src/util/BitKernels.h"
+
+#include <stdexcept>
+#include <string>
+
+#if defined(LRPARSER_SIMD) && (defined(__x86_64__) || defined(_M_X64)) &&      \
+    (defined(__GNUC__) || defined(__clang__))
+#define LRPARSER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace util::kernels {
+
+namespace {
+
+constexpr Table scalarTable{scalar::orInto,        scalar::andInto,
+                            scalar::orIntoChanged, scalar::andNotInto,
+                            scalar::equal,         scalar::intersects,
+                            scalar::hasAndNot,     scalar::allZero,
+                            scalar::hash};
+
+#ifdef LRPARSER_X86_KERNELS
+
+// Folds the remaining words and the lanes exactly like scalar::hash().
+size_t finishHash(word (&lanes)[4], word const *a, size_t from, size_t n) {
+    for (size_t i = from; i < n; ++i)
+        lanes[i % 4] = lanes[i % 4] * 31 + a[i];
+    size_t res = 17;
+    for (auto lane : lanes)
+        res = res * 31 + lane;
+    return res;
+}
+
+// SSE2 is part of x86-64, so these need no target attribute.
+namespace sse2 {
+
+constexpr size_t step = 2;
+
+__m128i load(word const *p) {
+    return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+}
+
+void store(word *p, __m128i v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+
+bool isZero(__m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(v, _mm_setzero_si128())) ==
+           0xffff;
+}
+
+void orInto(word *dst, word const *src, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step)
+        store(dst + i, _mm_or_si128(load(dst + i), load(src + i)));
+    scalar::orInto(dst + i, src + i, n - i);
+}
+
+void andInto(word *dst, word const *src, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step)
+        store(dst + i, _mm_and_si128(load(dst + i), load(src + i)));
+    scalar::andInto(dst + i, src + i, n - i);
+}
+
+bool orIntoChanged(word *dst, word const *src, size_t n) {
+    __m128i added = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        auto d = load(dst + i), s = load(src + i);
+        added = _mm_or_si128(added, _mm_andnot_si128(d, s));
+        store(dst + i, _mm_or_si128(d, s));
+    }
+    return scalar::orIntoChanged(dst + i, src + i, n - i) || !isZero(added);
+}
+
+void andNotInto(word *dst, word const *src, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step)
+        store(dst + i, _mm_andnot_si128(load(src + i), load(dst + i)));
+    scalar::andNotInto(dst + i, src + i, n - i);
+}
+
+bool equal(word const *a, word const *b, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        if (!isZero(_mm_xor_si128(load(a + i), load(b + i))))
+            return false;
+    }
+    return scalar::equal(a + i, b + i, n - i);
+}
+
+bool intersects(word const *a, word const *b, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        if (!isZero(_mm_and_si128(load(a + i), load(b + i))))
+            return true;
+    }
+    return scalar::intersects(a + i, b + i, n - i);
+}
+
+bool hasAndNot(word const *a, word const *b, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        if (!isZero(_mm_andnot_si128(load(b + i), load(a + i))))
+            return true;
+    }
+    return scalar::hasAndNot(a + i, b + i, n - i);
+}
+
+bool allZero(word const *a, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        if (!isZero(load(a + i)))
+            return false;
+    }
+    return scalar::allZero(a + i, n - i);
+}
+
+size_t hash(word const *a, size_t n) {
+    // Lanes 0-1 and 2-3. h * 31 is computed as (h << 5) - h.
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 * step <= n; i += 2 * step) {
+        lo = _mm_add_epi64(_mm_sub_epi64(_mm_slli_epi64(lo, 5), lo),
+                           load(a + i));
+        hi = _mm_add_epi64(_mm_sub_epi64(_mm_slli_epi64(hi, 5), hi),
+                           load(a + i + step));
+    }
+    word lanes[4];
+    store(lanes, lo);
+    store(lanes + 2, hi);
+    return finishHash(lanes, a, i, n);
+}
+
+constexpr Table table{orInto,     andInto,   orIntoChanged, andNotInto, equal,
+                      intersects, hasAndNot, allZero,       hash};
+
+} // namespace sse2
+
+#define LRPARSER_AVX2 __attribute__((target("avx2")))
+
+namespace avx2 {
+
+constexpr size_t step = 4;
+
+LRPARSER_AVX2 __m256i load(word const *p) {
+    return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+}
+
+LRPARSER_AVX2 void store(word *p, __m256i v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+
+LRPARSER_AVX2 void orInto(word *dst, word const *src, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step)
+        store(dst + i, _mm256_or_si256(load(dst + i), load(src + i)));
+    scalar::orInto(dst + i, src + i, n - i);
+}
+
+LRPARSER_AVX2 void andInto(word *dst, word const *src, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step)
+        store(dst + i, _mm256_and_si256(load(dst + i), load(src + i)));
+    scalar::andInto(dst + i, src + i, n - i);
+}
+
+LRPARSER_AVX2 bool orIntoChanged(word *dst, word const *src, size_t n) {
+    __m256i added = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        auto d = load(dst + i), s = load(src + i);
+        added = _mm256_or_si256(added, _mm256_andnot_si256(d, s));
+        store(dst + i, _mm256_or_si256(d, s));
+    }
+    return scalar::orIntoChanged(dst + i, src + i, n - i) ||
+           !_mm256_testz_si256(added, added);
+}
+
+LRPARSER_AVX2 void andNotInto(word *dst, word const *src, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step)
+        store(dst + i, _mm256_andnot_si256(load(src + i), load(dst + i)));
+    scalar::andNotInto(dst + i, src + i, n - i);
+}
+
+LRPARSER_AVX2 bool equal(word const *a, word const *b, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        auto x = _mm256_xor_si256(load(a + i), load(b + i));
+        if (!_mm256_testz_si256(x, x))
+            return false;
+    }
+    return scalar::equal(a + i, b + i, n - i);
+}
+
+LRPARSER_AVX2 bool intersects(word const *a, word const *b, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        if (!_mm256_testz_si256(load(a + i), load(b + i)))
+            return true;
+    }
+    return scalar::intersects(a + i, b + i, n - i);
+}
+
+LRPARSER_AVX2 bool hasAndNot(word const *a, word const *b, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        // testc(b, a) is 1 if a & ~b is zero.
+        if (!_mm256_testc_si256(load(b + i), load(a + i)))
+            return true;
+    }
+    return scalar::hasAndNot(a + i, b + i, n - i);
+}
+
+LRPARSER_AVX2 bool allZero(word const *a, size_t n) {
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        auto x = load(a + i);
+        if (!_mm256_testz_si256(x, x))
+            return false;
+    }
+    return scalar::allZero(a + i, n - i);
+}
+
+LRPARSER_AVX2 size_t hash(word const *a, size_t n) {
+    __m256i h = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        h = _mm256_add_epi64(_mm256_sub_epi64(_mm256_slli_epi64(h, 5), h),
+                             load(a + i));
+    }
+    word lanes[4];
+    store(lanes, h);
+    return finishHash(lanes, a, i, n);
+}
+
+constexpr Table table{orInto,     andInto,   orIntoChanged, andNotInto, equal,
+                      intersects, hasAndNot, allZero,       hash};
+
+} // namespace avx2
+
+#endif
+
+Table const *tableOf(Level level) {
+    switch (level) {
+#ifdef LRPARSER_X86_KERNELS
+    case Level::AVX2:
+        return &avx2::table;
+    case Level::SSE2:
+        return &sse2::table;
+#endif
+    default:
+        return &scalarTable;
+    }
+}
+
+Level level = Level::SCALAR;
+
+// Upgrades the table before main(). BitSets used by other static
+// initializers before this one runs get the scalar kernels, which is fine.
+[[maybe_unused]] bool const initialized = (setLevel(bestLevel()), true);
+
+} // namespace
+
+Table const *current = &scalarTable;
+
+Level bestLevel() {
+#ifdef LRPARSER_X86_KERNELS
+    if (__builtin_cpu_supports("avx2"))
+        return Level::AVX2;
+    return Level::SSE2;
+#else
+    return Level::SCALAR;
+#endif
+}
+
+Level getLevel() { return level; }
+
+void setLevel(Level newLevel) {
+    if (newLevel > bestLevel())
+        throw std::runtime_error(std::string("Bitset kernels are not "
+                                             "supported: ") +
+                                 levelName(newLevel));
+    level = newLevel;
+    current = tableOf(newLevel);
+}
+
+const char *levelName(Level l) {
+    switch (l) {
+    case Level::AVX2:
+        return "avx2";
+    case Level::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+} // namespace util::kernels
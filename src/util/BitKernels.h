@@ -0,0 +1,173 @@
+#ifndef LRPARSER_BIT_KERNELS_H
+#define LRPARSER_BIT_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Bulk operations on arrays of bitset blocks, used by util::BitSet.
+//
+// Arrays shorter than `min_words` are processed by the inline loops below,
+// since a call through the dispatch table costs more than the loop itself.
+// Longer arrays go to the best kernel the CPU supports: AVX2, SSE2 or the
+// same scalar loops. SIMD kernels are only built for x86-64 with GCC or
+// Clang, and only if the LRPARSER_SIMD option is on.
+//
+// All levels return exactly the same results, including hash().
+namespace util::kernels {
+
+using word = std::uint64_t;
+
+enum class Level { SCALAR, SSE2, AVX2 };
+
+constexpr size_t min_words = 4;
+
+struct Table {
+    void (*orInto)(word *dst, word const *src, size_t n);
+    void (*andInto)(word *dst, word const *src, size_t n);
+    // Ors src into dst, and returns whether dst has changed.
+    bool (*orIntoChanged)(word *dst, word const *src, size_t n);
+    // Removes the bits of src from dst.
+    void (*andNotInto)(word *dst, word const *src, size_t n);
+    bool (*equal)(word const *a, word const *b, size_t n);
+    bool (*intersects)(word const *a, word const *b, size_t n);
+    // Whether a has a bit which is not in b.
+    bool (*hasAndNot)(word const *a, word const *b, size_t n);
+    bool (*allZero)(word const *a, size_t n);
+    size_t (*hash)(word const *a, size_t n);
+};
+
+// Dispatch table of the current level.
+extern Table const *current;
+
+// The best level supported by this CPU and build.
+Level bestLevel();
+Level getLevel();
+// Throws if `level` is not supported. Not thread-safe: meant for tests and
+// benchmarks.
+void setLevel(Level level);
+const char *levelName(Level level);
+
+namespace scalar {
+
+inline void orInto(word *dst, word const *src, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] |= src[i];
+}
+
+inline void andInto(word *dst, word const *src, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] &= src[i];
+}
+
+inline bool orIntoChanged(word *dst, word const *src, size_t n) {
+    word added = 0;
+    for (size_t i = 0; i < n; ++i) {
+        added |= src[i] & ~dst[i];
+        dst[i] |= src[i];
+    }
+    return added != 0;
+}
+
+inline void andNotInto(word *dst, word const *src, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] &= ~src[i];
+}
+
+inline bool equal(word const *a, word const *b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] != b[i])
+            return false;
+    }
+    return true;
+}
+
+inline bool intersects(word const *a, word const *b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] & b[i])
+            return true;
+    }
+    return false;
+}
+
+inline bool hasAndNot(word const *a, word const *b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] & ~b[i])
+            return true;
+    }
+    return false;
+}
+
+inline bool allZero(word const *a, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i])
+            return false;
+    }
+    return true;
+}
+
+// Word i is added to lane i % 4 by h = h * 31 + w (mod 2^64), and the lanes
+// are combined at the end. Independent lanes let SIMD kernels compute the
+// same value 4 words at a time.
+inline size_t hash(word const *a, size_t n) {
+    word lanes[4] = {0};
+    for (size_t i = 0; i < n; ++i)
+        lanes[i % 4] = lanes[i % 4] * 31 + a[i];
+    size_t res = 17;
+    for (auto lane : lanes)
+        res = res * 31 + lane;
+    return res;
+}
+
+} // namespace scalar
+
+inline void orInto(word *dst, word const *src, size_t n) {
+    if (n < min_words)
+        scalar::orInto(dst, src, n);
+    else
+        current->orInto(dst, src, n);
+}
+
+inline void andInto(word *dst, word const *src, size_t n) {
+    if (n < min_words)
+        scalar::andInto(dst, src, n);
+    else
+        current->andInto(dst, src, n);
+}
+
+inline bool orIntoChanged(word *dst, word const *src, size_t n) {
+    return n < min_words ? scalar::orIntoChanged(dst, src, n)
+                         : current->orIntoChanged(dst, src, n);
+}
+
+inline void andNotInto(word *dst, word const *src, size_t n) {
+    if (n < min_words)
+        scalar::andNotInto(dst, src, n);
+    else
+        current->andNotInto(dst, src, n);
+}
+
+inline bool equal(word const *a, word const *b, size_t n) {
+    return n < min_words ? scalar::equal(a, b, n) : current->equal(a, b, n);
+}
+
+inline bool intersects(word const *a, word const *b, size_t n) {
+    return n < min_words ? scalar::intersects(a, b, n)
+                         : current->intersects(a, b, n);
+}
+
+inline bool hasAndNot(word const *a, word const *b, size_t n) {
+    return n < min_words ? scalar::hasAndNot(a, b, n)
+                         : current->hasAndNot(a, b, n);
+}
+
+inline bool allZero(word const *a, size_t n) {
+    return n < min_words ? scalar::allZero(a, n) : current->allZero(a, n);
+}
+
+inline size_t hash(word const *a, size_t n) {
+    return n < min_words ? scalar::hash(a, n) : current->hash(a, n);
+}
+
+} // namespace util::kernels
+
+#endif
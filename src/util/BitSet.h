@@ -9,6 +9,7 @@
 #include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iterator>
 #include <stdexcept>
@@ -17,6 +18,10 @@
 #include <string>
 
 #include "src/common.h"
+#include "src/util/AllocStats.h"
+#include "src/util/BitKernels.h"
+#include "src/util/BlockArena.h"
+#include "src/util/Bits.h"
 
 namespace util {
 
@@ -25,8 +30,7 @@ namespace util {
 // Template argument T is used for type check.
 template <class T> class BitSet {
   public:
-    using block_type = unsigned int;
-    using block_signed_type = int;
+    using block_type = std::uint64_t;
     using size_type = ::size_t;
     static constexpr size_type block_bits = sizeof(block_type) * 8;
     static constexpr size_type npos = static_cast<size_type>(-1);
@@ -36,6 +40,8 @@ template <class T> class BitSet {
 
     static_assert(std::is_integral_v<T> || std::is_enum_v<T>,
                   "BitSet can only hold integral types");
+    static_assert(std::is_same_v<block_type, kernels::word>,
+                  "Bulk operations are implemented in BitKernels.h");
 
   private:
     // **Initializing all data here is much safer**
@@ -49,21 +55,42 @@ template <class T> class BitSet {
     // Capacity in blocks
     size_type m_size = n_inner_blocks;
 
+    // Arena which `m_data` is allocated from, or nullptr for the heap.
+    BlockArena *m_arena = nullptr;
+
     // Prerequisite: m_size must be set.
     void allocMemory(size_type size, bool setBitsToZeros = true) {
-        m_data =
-            (size > n_inner_blocks) ? new block_type[size] : &inner_blocks[0];
+        m_arena = nullptr;
+        if (size > n_inner_blocks) {
+            m_arena = BlockArena::current();
+            if (m_arena) {
+                m_data = m_arena->allocate(size);
+            } else {
+                m_data = new block_type[size];
+                AllocStats::countBitSetBlocks();
+            }
+        } else {
+            m_data = &inner_blocks[0];
+        }
         m_size = size;
         if (!setBitsToZeros)
             return;
         fillZeros(m_data, 0, size);
     }
 
+    static void releaseBlocks(BlockArena *arena, block_type *data,
+                              size_type size) {
+        if (arena)
+            arena->deallocate(data, size);
+        else
+            delete[] data;
+    }
+
     void freeMemory() {
         if (m_data && m_data != &inner_blocks[0]) {
             assert(m_size > n_inner_blocks);
 
-            delete[] m_data;
+            releaseBlocks(m_arena, m_data, m_size);
             m_data = nullptr;
         }
     }
@@ -76,7 +103,8 @@ template <class T> class BitSet {
         }
         auto prevData = m_data;
         auto prevSize = m_size;
-        size_type capacity = roundToNextPowerOf2(leastBlocksNeeded);
+        auto prevArena = m_arena;
+        size_type capacity = bitCeil(leastBlocksNeeded);
         // Because m_size is always larger than or equal to n_inner_blocks, and
         // leastBlocksNeeded > m_size now, we know that inner blocks cannot be
         // used. allocMemory() will definitely request a dynamically allocated
@@ -85,42 +113,10 @@ template <class T> class BitSet {
         copyRange(m_data, prevData, 0, prevSize);
         fillZeros(m_data, prevSize, m_size);
         if (prevData != &inner_blocks[0]) {
-            delete[] prevData;
+            releaseBlocks(prevArena, prevData, prevSize);
         }
     }
 
-    // T is used for BitSet template argument, use SizeT instead.
-    template<class SizeT, typename std::enable_if_t<sizeof(SizeT) == 8, int> = 0>
-    static auto roundToNextPowerOf2(SizeT i) {
-        static_assert(std::is_unsigned_v<SizeT>);
-        if (i <= 2)
-            return i;
-        --i;
-        i |= i >> 1;
-        i |= i >> 2;
-        i |= i >> 4;
-        i |= i >> 8;
-        i |= i >> 16;
-        i |= i >> 32;
-        return 1 + i;
-    }
-
-    // T is used for BitSet template argument, use SizeT instead.
-    // This version is provided to avoid UB on Win32.
-    template<class SizeT, typename std::enable_if_t<sizeof(SizeT) == 4, int> = 0>
-    static auto roundToNextPowerOf2(SizeT i) {
-        static_assert(std::is_unsigned_v<SizeT>);
-        if (i <= 2)
-            return i;
-        --i;
-        i |= i >> 1;
-        i |= i >> 2;
-        i |= i >> 4;
-        i |= i >> 8;
-        i |= i >> 16;
-        return 1 + i;
-    }
-
     // Fill data to 0 in range [from, to).
     static inline void fillZeros(block_type *data, size_type from,
                                  size_type to) {
@@ -147,20 +143,33 @@ template <class T> class BitSet {
         }
     }
 
+    size_type findFrom(size_type pos) const {
+        size_type i = pos / block_bits;
+        if (i >= m_size)
+            return npos;
+        block_type x = m_data[i] & (mask_all_ones << (pos % block_bits));
+        while (!x) {
+            if (++i == m_size)
+                return npos;
+            x = m_data[i];
+        }
+        return i * block_bits + ctz(x);
+    }
+
     // Set N-th bit. If dynamical expansion is needed, use ensure() first.
     // Only set() and insert() need to ensure that T >= 0.
     void set(size_type N, bool flag = true) {
         assert(N < m_size * block_bits);
         if (flag)
-            m_data[N / block_bits] |= 1LLU << (N % block_bits);
+            m_data[N / block_bits] |= block_type{1} << (N % block_bits);
         else
-            m_data[N / block_bits] &= ~(1LLU << (N % block_bits));
+            m_data[N / block_bits] &= ~(block_type{1} << (N % block_bits));
     }
 
   public:
     explicit BitSet(size_type N)
         : inner_blocks({0}),
-          m_size(roundToNextPowerOf2((N + block_bits - 1) / block_bits)) {
+          m_size(bitCeil((N + block_bits - 1) / block_bits)) {
         // Make sure m_size is at least n_inner_blocks
         if (m_size < n_inner_blocks) {
             m_size = n_inner_blocks;
@@ -232,15 +241,65 @@ template <class T> class BitSet {
         auto N = static_cast<size_type>(N_);
         if (N >= m_size * block_bits)
             return false;
-        return m_data[N / block_bits] & (1LLU << (N % block_bits));
+        return m_data[N / block_bits] & (block_type{1} << (N % block_bits));
     }
 
     [[nodiscard]] bool empty() const {
+        return kernels::allZero(m_data, m_size);
+    }
+
+    // Number of bits set.
+    [[nodiscard]] size_type count() const {
+        size_type n = 0;
+        for (size_type i = 0; i < m_size; ++i)
+            n += popcount(m_data[i]);
+        return n;
+    }
+
+    // Block `i`, or 0 if it is beyond the capacity.
+    [[nodiscard]] block_type getBlock(size_type i) const {
+        return i < m_size ? m_data[i] : 0;
+    }
+
+    // Bytes allocated on the heap.
+    [[nodiscard]] size_type memoryUsage() const {
+        return m_data != &inner_blocks[0] ? m_size * sizeof(block_type) : 0;
+    }
+
+    // Position of the first bit set, or npos.
+    [[nodiscard]] size_type findFirst() const { return findFrom(0); }
+
+    // Position of the first bit set after `pos`, or npos.
+    [[nodiscard]] size_type findNext(size_type pos) const {
+        return pos + 1 == 0 ? npos : findFrom(pos + 1);
+    }
+
+    // Calls f(index, word) for each block which is not 0. Bit b of the word
+    // is element index * block_bits + b.
+    template <class F> void forEachWord(F &&f) const {
         for (size_type i = 0; i < m_size; ++i) {
             if (m_data[i])
-                return false;
+                f(i, m_data[i]);
+        }
+    }
+
+    // Calls f(element) in ascending order. Faster than iterators.
+    template <class F> void forEach(F &&f) const {
+        for (size_type i = 0; i < m_size; ++i) {
+            for (block_type x = m_data[i]; x; x &= x - 1)
+                f(static_cast<T>(i * block_bits + ctz(x)));
+        }
+    }
+
+    // Calls f(element) for each element of both sets in ascending order,
+    // without building the intersection.
+    template <class F>
+    void forEachIntersection(BitSet const &other, F &&f) const {
+        auto limit = std::min(m_size, other.m_size);
+        for (size_type i = 0; i < limit; ++i) {
+            for (block_type x = m_data[i] & other.m_data[i]; x; x &= x - 1)
+                f(static_cast<T>(i * block_bits + ctz(x)));
         }
-        return true;
     }
 
     // Clear all bits and make bitset usable again (even if it was moved).
@@ -261,15 +320,8 @@ template <class T> class BitSet {
             std::swap(smaller, larger);
         }
         size_type sz = smaller->m_size;
-        for (size_type i = 0; i < sz; ++i) {
-            if (m_data[i] != other.m_data[i])
-                return false;
-        }
-        for (size_type i = sz; i < larger->m_size; ++i) {
-            if (larger->m_data[i])
-                return false;
-        }
-        return true;
+        return kernels::equal(m_data, other.m_data, sz) &&
+               kernels::allZero(larger->m_data + sz, larger->m_size - sz);
     }
 
     bool operator!=(BitSet const &other) const {
@@ -278,17 +330,29 @@ template <class T> class BitSet {
 
     BitSet &operator&=(BitSet const &other) {
         ensure(other.m_size * block_bits);
-        for (size_type i = 0; i < other.m_size; ++i) {
-            m_data[i] &= other.m_data[i];
-        }
+        kernels::andInto(m_data, other.m_data, other.m_size);
+        // Bits beyond `other` are not in the intersection.
+        fillZeros(m_data, other.m_size, m_size);
         return *this;
     }
 
     BitSet &operator|=(BitSet const &other) {
         ensure(other.m_size * block_bits);
-        for (size_type i = 0; i < other.m_size; ++i) {
-            m_data[i] |= other.m_data[i];
-        }
+        kernels::orInto(m_data, other.m_data, other.m_size);
+        return *this;
+    }
+
+    // Same as |=, but returns whether any bit was added. Saves the copy
+    // and comparison of fixed-point loops.
+    bool orAssignChanged(BitSet const &other) {
+        ensure(other.m_size * block_bits);
+        return kernels::orIntoChanged(m_data, other.m_data, other.m_size);
+    }
+
+    // Removes all bits of `other` from this set.
+    BitSet &andNotInto(BitSet const &other) {
+        auto limit = std::min(m_size, other.m_size);
+        kernels::andNotInto(m_data, other.m_data, limit);
         return *this;
     }
 
@@ -304,38 +368,17 @@ template <class T> class BitSet {
     // Test if two bitsets have intersection
     [[nodiscard]] bool hasIntersection(BitSet const &other) const {
         auto min_size = m_size < other.m_size ? m_size : other.m_size;
-        for (size_type i = 0; i < min_size; ++i) {
-            if (m_data[i] & other.m_data[i])
-                return true;
-        }
-        return false;
+        return kernels::intersects(m_data, other.m_data, min_size);
     }
 
     [[nodiscard]] bool supersetOf(BitSet const &other) const {
         auto limit = std::min(this->m_size, other.m_size);
-        for (size_type i = 0; i < limit; ++i) {
-            block_type x = m_data[i];
-            block_type y = other.m_data[i];
-            if (y & ~x)
-                return false;
-        }
-        for (size_type i = limit; i < other.m_size; ++i) {
-            if (other.m_data[i])
-                return false;
-        }
-        return true;
+        return !kernels::hasAndNot(other.m_data, m_data, limit) &&
+               kernels::allZero(other.m_data + limit, other.m_size - limit);
     }
 
     [[nodiscard]] bool subsetOf(BitSet const &other) const {
-        auto limit = std::min(this->m_size, other.m_size);
-        // ensure(other.m_size * block_bits);
-        for (size_type i = 0; i < limit; ++i) {
-            block_type x = m_data[i];
-            block_type y = other.m_data[i];
-            if (x & ~y)
-                return false;
-        }
-        return true;
+        return other.supersetOf(*this);
     }
 
     // Dump this bitset in human-readable format.
@@ -377,25 +420,11 @@ template <class T> class BitSet {
                 return false;
             }
 
-            x = x & (block_type)(-(block_signed_type)x); // Get right most bit
-            mask &= ~x; // Set mask for further use
-
-            size_type pos = block_bits - 1;
-            if (x & 0x0000'ffff)
-                pos -= 16;
-            if (x & 0x00ff'00ff)
-                pos -= 8;
-            if (x & 0x0f0f'0f0f)
-                pos -= 4;
-            if (x & 0x3333'3333)
-                pos -= 2;
-            if (x & 0x5555'5555)
-                --pos;
+            auto pos = static_cast<size_type>(ctz(x));
+            mask &= ~(block_type{1} << pos); // Set mask for further use
 
             // Add offset to global position
-            pos = index * block_bits + pos;
-
-            availablePos = pos;
+            availablePos = index * block_bits + pos;
             return true;
         }
 
@@ -432,14 +461,7 @@ template <class T> class BitSet {
 namespace std {
 template <class T> struct hash<util::BitSet<T>> {
     std::size_t operator()(util::BitSet<T> const &bitset) const {
-        using std::hash;
-        std::size_t res = 17;
-        for (typename util::BitSet<T>::size_type i = 0; i < bitset.m_size;
-             ++i) {
-            res = res * 31 + hash<typename util::BitSet<T>::block_type>()(
-                                 bitset.m_data[i]);
-        }
-        return res;
+        return util::kernels::hash(bitset.m_data, bitset.m_size);
     }
 };
 } // namespace std
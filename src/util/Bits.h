@@ -0,0 +1,56 @@
+#ifndef LRPARSER_BITS_H
+#define LRPARSER_BITS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Bit manipulation on 64-bit words, standing in for C++20 <bit>.
+namespace util {
+
+// Index of the lowest set bit. `x` must not be 0.
+inline int ctz(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return static_cast<int>(index);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline int popcount(std::uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    // SWAR count, since __popcnt64 needs a CPU check on MSVC.
+    x = x - ((x >> 1) & 0x5555'5555'5555'5555ULL);
+    x = (x & 0x3333'3333'3333'3333ULL) + ((x >> 2) & 0x3333'3333'3333'3333ULL);
+    x = (x + (x >> 4)) & 0x0f0f'0f0f'0f0f'0f0fULL;
+    return static_cast<int>((x * 0x0101'0101'0101'0101ULL) >> 56);
+#endif
+}
+
+// The smallest power of 2 which is not less than `x`. Returns 1 for 0.
+inline size_t bitCeil(size_t x) {
+    if (x <= 1)
+        return 1;
+    --x;
+    for (size_t shift = 1; shift < sizeof(size_t) * 8; shift <<= 1)
+        x |= x >> shift;
+    return x + 1;
+}
+
+} // namespace util
+
+#endif
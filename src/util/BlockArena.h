@@ -0,0 +1,87 @@
+#ifndef LRPARSER_BLOCK_ARENA_H
+#define LRPARSER_BLOCK_ARENA_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "src/util/Arena.h"
+#include "src/util/Bits.h"
+
+namespace util {
+
+// Arrays of 64-bit words whose sizes are powers of 2, carved from an Arena.
+// Freed arrays are kept in a free list per size and handed out again, so
+// temporary sets don't make the arena grow. Everything is released at once
+// when the arena is destroyed.
+//
+// BitSet allocates its blocks from the arena installed on the current thread
+// by a Scope, and from the heap if there is none. A BitSet allocated from an
+// arena must be destroyed before the arena.
+class BlockArena {
+  public:
+    using word = std::uint64_t;
+
+    BlockArena() = default;
+    BlockArena(BlockArena const &other) = delete;
+    BlockArena &operator=(BlockArena const &other) = delete;
+
+    // `n` must be a power of 2.
+    word *allocate(size_t n) {
+        assert(n && (n & (n - 1)) == 0);
+        ++requestCount;
+        auto &head = freeLists[ctz(n)];
+        if (head) {
+            ++reuseCount;
+            word *p = head;
+            std::memcpy(&head, p, sizeof(word *));
+            return p;
+        }
+        return arena.allocateArray<word>(n);
+    }
+
+    // `p` must be returned by allocate(n) of this arena.
+    void deallocate(word *p, size_t n) {
+        auto &head = freeLists[ctz(n)];
+        std::memcpy(p, &head, sizeof(word *));
+        head = p;
+    }
+
+    // The arena which BitSets allocate from on this thread, or nullptr.
+    static BlockArena *current() { return currentArena; }
+
+    // Installs an arena on this thread until the scope ends.
+    class Scope {
+      public:
+        explicit Scope(BlockArena &arena) : previous(currentArena) {
+            currentArena = &arena;
+        }
+        Scope(Scope const &other) = delete;
+        Scope &operator=(Scope const &other) = delete;
+        ~Scope() { currentArena = previous; }
+
+      private:
+        BlockArena *previous;
+    };
+
+    // Statistics
+    // Arrays handed out, either new or reused.
+    [[nodiscard]] size_t requests() const { return requestCount; }
+    [[nodiscard]] size_t reused() const { return reuseCount; }
+    // Calls to malloc() made for all of them.
+    [[nodiscard]] size_t chunks() const { return arena.chunks(); }
+    [[nodiscard]] size_t bytes() const { return arena.bytes(); }
+
+  private:
+    static inline thread_local BlockArena *currentArena = nullptr;
+
+    Arena arena;
+    word *freeLists[64] = {};
+    size_t requestCount = 0;
+    size_t reuseCount = 0;
+};
+
+} // namespace util
+
+#endif
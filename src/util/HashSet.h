@@ -2,6 +2,7 @@
 #define HASH_SET
 
 #include <algorithm>
+#include <cstdint>
 #include <type_traits>
 #include <unordered_set>
 
@@ -20,7 +21,7 @@ template <class T> class HashSet : public std::unordered_set<int> {
 
     HashSet() = default;
 
-    explicit HashSet(size_type N) {}
+    explicit HashSet(size_type /*N*/) {}
 
     void remove(T N_) { std::unordered_set<element_type>::erase(N_); }
 
@@ -46,16 +47,37 @@ template <class T> class HashSet : public std::unordered_set<int> {
         this->swap(result);
         return *this;
     }
+
+    template <class F> void forEach(F &&f) const {
+        for (auto e : *this)
+            f(static_cast<T>(e));
+    }
+
+    // Calls f(element) for each element in both sets, in no particular order.
+    template <class F>
+    void forEachIntersection(HashSet const &other, F &&f) const {
+        bool smaller = this->size() <= other.size();
+        auto const &probe = smaller ? *this : other;
+        auto const &table = smaller ? other : *this;
+        for (auto e : probe) {
+            if (table.count(e) != 0)
+                f(static_cast<T>(e));
+        }
+    }
 };
 
 } // namespace util
 
 namespace std {
+// The iteration order of equal sets depends on their bucket counts and
+// insertion history, so the hash must not depend on it. Elements are mixed
+// and summed instead.
 template <class T> struct hash<util::HashSet<T>> {
     size_t operator()(util::HashSet<T> const &s) const {
         size_t result = 17;
         for (auto e : s) {
-            result = result * 31 + e;
+            auto x = static_cast<uint64_t>(e) * 0x9e37'79b9'7f4a'7c15ULL;
+            result += static_cast<size_t>(x ^ (x >> 32));
         }
         return result;
     }
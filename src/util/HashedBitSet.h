@@ -0,0 +1,205 @@
+#ifndef LRPARSER_HASHED_BITSET_H
+#define LRPARSER_HASHED_BITSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "src/util/BitSet.h"
+
+namespace util {
+
+// A BitSet which keeps its hash up to date, so that it can be looked up in
+// hash tables without walking its blocks.
+//
+// The hash is the sum of mix(i, block i) over all blocks. mix() is 0 for an
+// empty block, so sets which only differ in capacity have the same hash, as
+// == requires. insert(), remove(), |= and andNotInto() update the hash block
+// by block. &= recomputes it.
+template <class T> class HashedBitSet {
+  public:
+    using bitset_type = BitSet<T>;
+    using size_type = typename bitset_type::size_type;
+    using block_type = typename bitset_type::block_type;
+    using Iterator = typename bitset_type::Iterator;
+    static constexpr size_type npos = bitset_type::npos;
+    static constexpr size_type block_bits = bitset_type::block_bits;
+
+  private:
+    bitset_type m_bits;
+    size_t m_hash = 0;
+
+    // Spreads the block over all bits with the finalizer of MurmurHash3.
+    static size_t mix(size_type index, block_type block) {
+        if (!block)
+            return 0;
+        std::uint64_t x = block ^ (index * 0x9e37'79b9'7f4a'7c15ULL);
+        x ^= x >> 33;
+        x *= 0xff51'afd7'ed55'8ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ce'b9fe'1a85'ec53ULL;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+
+    void rehash() {
+        m_hash = 0;
+        m_bits.forEachWord(
+            [this](size_type i, block_type block) { m_hash += mix(i, block); });
+    }
+
+    void update(size_type index, block_type before) {
+        block_type after = m_bits.getBlock(index);
+        if (after != before)
+            m_hash += mix(index, after) - mix(index, before);
+    }
+
+  public:
+    HashedBitSet() = default;
+
+    explicit HashedBitSet(size_type N) : m_bits(N) {}
+
+    explicit HashedBitSet(bitset_type bits) : m_bits(std::move(bits)) {
+        rehash();
+    }
+
+    [[nodiscard]] bitset_type const &bits() const { return m_bits; }
+
+    [[nodiscard]] size_t hash() const { return m_hash; }
+
+    void insert(T N_) {
+        auto index = static_cast<size_type>(N_) / block_bits;
+        auto before = m_bits.getBlock(index);
+        m_bits.insert(N_);
+        update(index, before);
+    }
+
+    void remove(T N_) {
+        auto index = static_cast<size_type>(N_) / block_bits;
+        auto before = m_bits.getBlock(index);
+        m_bits.remove(N_);
+        update(index, before);
+    }
+
+    [[nodiscard]] bool contains(T N_) const { return m_bits.contains(N_); }
+    [[nodiscard]] bool empty() const { return m_bits.empty(); }
+    [[nodiscard]] size_type count() const { return m_bits.count(); }
+    [[nodiscard]] size_type findFirst() const { return m_bits.findFirst(); }
+    [[nodiscard]] size_type findNext(size_type pos) const {
+        return m_bits.findNext(pos);
+    }
+    [[nodiscard]] size_type memoryUsage() const {
+        return m_bits.memoryUsage();
+    }
+    [[nodiscard]] std::string dump() const { return m_bits.dump(); }
+
+    template <class F> void forEachWord(F &&f) const {
+        m_bits.forEachWord(std::forward<F>(f));
+    }
+
+    template <class F> void forEach(F &&f) const {
+        m_bits.forEach(std::forward<F>(f));
+    }
+
+    void clear() {
+        m_bits.clear();
+        m_hash = 0;
+    }
+
+    // Sets with different hashes are rejected without comparing blocks.
+    bool operator==(HashedBitSet const &other) const {
+        return m_hash == other.m_hash && m_bits == other.m_bits;
+    }
+
+    bool operator!=(HashedBitSet const &other) const {
+        return !(*this == other);
+    }
+
+    HashedBitSet &operator|=(bitset_type const &other) {
+        orAssignChanged(other);
+        return *this;
+    }
+
+    // Same as |=, but returns whether any bit was added.
+    bool orAssignChanged(bitset_type const &other) {
+        bool changed = false;
+        other.forEachWord([this, &changed](size_type i, block_type block) {
+            auto blockBefore = m_bits.getBlock(i);
+            if ((blockBefore | block) != blockBefore) {
+                m_hash += mix(i, blockBefore | block) - mix(i, blockBefore);
+                changed = true;
+            }
+        });
+        if (!changed)
+            return false;
+        m_bits |= other;
+        return true;
+    }
+
+    bool orAssignChanged(HashedBitSet const &other) {
+        return orAssignChanged(other.m_bits);
+    }
+
+    // Removes all bits of `other` from this set.
+    HashedBitSet &andNotInto(bitset_type const &other) {
+        other.forEachWord([this](size_type i, block_type block) {
+            auto blockBefore = m_bits.getBlock(i);
+            if (blockBefore & block)
+                m_hash += mix(i, blockBefore & ~block) - mix(i, blockBefore);
+        });
+        m_bits.andNotInto(other);
+        return *this;
+    }
+
+    HashedBitSet &andNotInto(HashedBitSet const &other) {
+        return andNotInto(other.m_bits);
+    }
+
+    template <class F>
+    void forEachIntersection(HashedBitSet const &other, F &&f) const {
+        m_bits.forEachIntersection(other.m_bits, std::forward<F>(f));
+    }
+
+    HashedBitSet &operator|=(HashedBitSet const &other) {
+        return *this |= other.m_bits;
+    }
+
+    HashedBitSet &operator&=(bitset_type const &other) {
+        m_bits &= other;
+        rehash();
+        return *this;
+    }
+
+    HashedBitSet &operator&=(HashedBitSet const &other) {
+        return *this &= other.m_bits;
+    }
+
+    [[nodiscard]] bool hasIntersection(HashedBitSet const &other) const {
+        return m_bits.hasIntersection(other.m_bits);
+    }
+
+    [[nodiscard]] bool supersetOf(HashedBitSet const &other) const {
+        return m_bits.supersetOf(other.m_bits);
+    }
+
+    [[nodiscard]] bool subsetOf(HashedBitSet const &other) const {
+        return m_bits.subsetOf(other.m_bits);
+    }
+
+    [[nodiscard]] Iterator begin() const { return m_bits.begin(); }
+    [[nodiscard]] Iterator end() const { return m_bits.end(); }
+};
+
+} // namespace util
+
+namespace std {
+template <class T> struct hash<util::HashedBitSet<T>> {
+    std::size_t operator()(util::HashedBitSet<T> const &set) const {
+        return set.hash();
+    }
+};
+} // namespace std
+
+#endif
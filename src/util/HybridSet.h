@@ -0,0 +1,514 @@
+#ifndef LRPARSER_HYBRID_SET_H
+#define LRPARSER_HYBRID_SET_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "src/util/BitKernels.h"
+#include "src/util/Bits.h"
+
+namespace util {
+
+// A set of non-negative integers in the style of roaring bitmaps, with the
+// same interface as BitSet. Elements are grouped into chunks of 2^16 values
+// by their high bits. A chunk with at most `max_array` elements is a sorted
+// array of the low bits, and a fuller chunk is a bitmap. So a small set over
+// a large range, like an LR(1) closure over all NFA states, takes memory in
+// proportion to its size instead of the range.
+//
+// The representation is canonical (a chunk is a bitmap if and only if it has
+// more than `max_array` elements, and there are no empty chunks), so equal
+// sets have equal chunks.
+template <class T> class HybridSet {
+  public:
+    using size_type = ::size_t;
+    using low_type = std::uint16_t;
+    using word = kernels::word;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+    static constexpr size_type chunk_bits = 16;
+    static constexpr size_type chunk_size = size_type{1} << chunk_bits;
+    static constexpr size_type word_bits = sizeof(word) * 8;
+    static constexpr size_type bitmap_words = chunk_size / word_bits;
+    // Arrays larger than this would take more memory than a bitmap.
+    static constexpr size_type max_array =
+        bitmap_words * sizeof(word) / sizeof(low_type);
+    friend struct std::hash<util::HybridSet<T>>;
+
+    static_assert(std::is_integral_v<T> || std::is_enum_v<T>,
+                  "HybridSet can only hold integral types");
+
+  private:
+    struct Chunk {
+        size_type key; // High bits of the elements
+        size_type count = 0;
+        std::vector<low_type> array; // Used if count <= max_array
+        std::vector<word> bitmap;    // Used otherwise
+
+        explicit Chunk(size_type key) : key(key) {}
+
+        [[nodiscard]] bool dense() const { return !bitmap.empty(); }
+
+        [[nodiscard]] bool contains(low_type low) const {
+            if (dense())
+                return bitmap[low / word_bits] >> (low % word_bits) & 1;
+            return std::binary_search(array.begin(), array.end(), low);
+        }
+
+        void insert(low_type low) {
+            if (dense()) {
+                word &w = bitmap[low / word_bits];
+                word bit = word{1} << (low % word_bits);
+                count += !(w & bit);
+                w |= bit;
+                return;
+            }
+            auto it = std::lower_bound(array.begin(), array.end(), low);
+            if (it != array.end() && *it == low)
+                return;
+            array.insert(it, low);
+            ++count;
+            normalize();
+        }
+
+        void remove(low_type low) {
+            if (dense()) {
+                word &w = bitmap[low / word_bits];
+                word bit = word{1} << (low % word_bits);
+                count -= !!(w & bit);
+                w &= ~bit;
+                normalize();
+                return;
+            }
+            auto it = std::lower_bound(array.begin(), array.end(), low);
+            if (it != array.end() && *it == low) {
+                array.erase(it);
+                --count;
+            }
+        }
+
+        void toBitmap() {
+            bitmap.assign(bitmap_words, 0);
+            for (auto low : array)
+                bitmap[low / word_bits] |= word{1} << (low % word_bits);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        void toArray() {
+            array.clear();
+            array.reserve(count);
+            forEach([this](size_type low) {
+                array.push_back(static_cast<low_type>(low));
+            });
+            bitmap.clear();
+            bitmap.shrink_to_fit();
+        }
+
+        // Restores the canonical representation after `count` changed.
+        void normalize() {
+            if (!dense() && count > max_array)
+                toBitmap();
+            else if (dense() && count <= max_array)
+                toArray();
+        }
+
+        void recount() {
+            count = 0;
+            for (auto w : bitmap)
+                count += popcount(w);
+        }
+
+        void unite(Chunk const &other) {
+            if (other.dense()) {
+                if (!dense())
+                    toBitmap();
+                kernels::orInto(bitmap.data(), other.bitmap.data(),
+                                bitmap_words);
+                recount();
+            } else if (dense()) {
+                for (auto low : other.array) {
+                    word &w = bitmap[low / word_bits];
+                    word bit = word{1} << (low % word_bits);
+                    count += !(w & bit);
+                    w |= bit;
+                }
+            } else {
+                std::vector<low_type> result;
+                result.reserve(array.size() + other.array.size());
+                std::set_union(array.begin(), array.end(), other.array.begin(),
+                               other.array.end(), std::back_inserter(result));
+                array.swap(result);
+                count = array.size();
+            }
+            normalize();
+        }
+
+        void intersect(Chunk const &other) {
+            if (dense() && other.dense()) {
+                kernels::andInto(bitmap.data(), other.bitmap.data(),
+                                 bitmap_words);
+                recount();
+            } else if (dense()) {
+                std::vector<low_type> result;
+                for (auto low : other.array) {
+                    if (contains(low))
+                        result.push_back(low);
+                }
+                bitmap.clear();
+                bitmap.shrink_to_fit();
+                array.swap(result);
+                count = array.size();
+            } else if (other.dense() || array.size() * 16 < other.count) {
+                // Look up the few elements of this chunk in the other.
+                auto end = std::remove_if(
+                    array.begin(), array.end(),
+                    [&other](low_type low) { return !other.contains(low); });
+                array.erase(end, array.end());
+                count = array.size();
+            } else if (other.count * 16 < array.size()) {
+                std::vector<low_type> result;
+                for (auto low : other.array) {
+                    if (contains(low))
+                        result.push_back(low);
+                }
+                array.swap(result);
+                count = array.size();
+            } else {
+                std::vector<low_type> result;
+                std::set_intersection(array.begin(), array.end(),
+                                      other.array.begin(), other.array.end(),
+                                      std::back_inserter(result));
+                array.swap(result);
+                count = array.size();
+            }
+            normalize();
+        }
+
+        bool operator==(Chunk const &other) const {
+            return key == other.key && count == other.count &&
+                   (dense() ? kernels::equal(bitmap.data(),
+                                             other.bitmap.data(), bitmap_words)
+                            : array == other.array);
+        }
+
+        // Calls f(low) in ascending order.
+        template <class F> void forEach(F &&f) const {
+            if (!dense()) {
+                for (auto low : array)
+                    f(size_type{low});
+                return;
+            }
+            for (size_type i = 0; i < bitmap_words; ++i) {
+                for (word x = bitmap[i]; x; x &= x - 1)
+                    f(i * word_bits + ctz(x));
+            }
+        }
+
+        // Position of the first bit set at or after `pos` in a bitmap, or
+        // npos.
+        [[nodiscard]] size_type findBit(size_type pos) const {
+            size_type i = pos / word_bits;
+            if (i >= bitmap_words)
+                return npos;
+            word x = bitmap[i] & (~word{0} << (pos % word_bits));
+            while (!x) {
+                if (++i == bitmap_words)
+                    return npos;
+                x = bitmap[i];
+            }
+            return i * word_bits + ctz(x);
+        }
+    };
+
+    // Sorted by key.
+    std::vector<Chunk> chunks;
+
+    static size_type keyOf(size_type n) { return n >> chunk_bits; }
+    static low_type lowOf(size_type n) {
+        return static_cast<low_type>(n & (chunk_size - 1));
+    }
+
+    auto findChunk(size_type key) const {
+        return std::lower_bound(
+            chunks.begin(), chunks.end(), key,
+            [](Chunk const &c, size_type key) { return c.key < key; });
+    }
+
+    auto findChunk(size_type key) {
+        return std::lower_bound(
+            chunks.begin(), chunks.end(), key,
+            [](Chunk const &c, size_type key) { return c.key < key; });
+    }
+
+  public:
+    HybridSet() = default;
+
+    // `N` is ignored. It is accepted so that HybridSet can replace BitSet.
+    explicit HybridSet(size_type /*N*/) {}
+
+    void insert(T N_) {
+        assert(N_ >= 0);
+        auto N = static_cast<size_type>(N_);
+        auto it = findChunk(keyOf(N));
+        if (it == chunks.end() || it->key != keyOf(N))
+            it = chunks.emplace(it, keyOf(N));
+        it->insert(lowOf(N));
+    }
+
+    void remove(T N_) {
+        if (N_ < 0)
+            return;
+        auto N = static_cast<size_type>(N_);
+        auto it = findChunk(keyOf(N));
+        if (it == chunks.end() || it->key != keyOf(N))
+            return;
+        it->remove(lowOf(N));
+        if (it->count == 0)
+            chunks.erase(it);
+    }
+
+    [[nodiscard]] bool contains(T N_) const {
+        if (N_ < 0)
+            return false;
+        auto N = static_cast<size_type>(N_);
+        auto it = findChunk(keyOf(N));
+        return it != chunks.end() && it->key == keyOf(N) &&
+               it->contains(lowOf(N));
+    }
+
+    [[nodiscard]] bool empty() const { return chunks.empty(); }
+
+    void clear() { chunks.clear(); }
+
+    // Number of elements.
+    [[nodiscard]] size_type count() const {
+        size_type n = 0;
+        for (auto const &chunk : chunks)
+            n += chunk.count;
+        return n;
+    }
+
+    // Bytes allocated on the heap.
+    [[nodiscard]] size_type memoryUsage() const {
+        size_type bytes = chunks.capacity() * sizeof(Chunk);
+        for (auto const &chunk : chunks) {
+            bytes += chunk.array.capacity() * sizeof(low_type) +
+                     chunk.bitmap.capacity() * sizeof(word);
+        }
+        return bytes;
+    }
+
+    bool operator==(HybridSet const &other) const {
+        return chunks == other.chunks;
+    }
+
+    bool operator!=(HybridSet const &other) const {
+        return !(*this == other);
+    }
+
+    HybridSet &operator|=(HybridSet const &other) {
+        std::vector<Chunk> result;
+        result.reserve(chunks.size() + other.chunks.size());
+        auto i1 = chunks.begin(), e1 = chunks.end();
+        auto i2 = other.chunks.begin(), e2 = other.chunks.end();
+        while (i1 != e1 || i2 != e2) {
+            if (i2 == e2 || (i1 != e1 && i1->key < i2->key)) {
+                result.push_back(std::move(*i1++));
+            } else if (i1 == e1 || i2->key < i1->key) {
+                result.push_back(*i2++);
+            } else {
+                i1->unite(*i2++);
+                result.push_back(std::move(*i1++));
+            }
+        }
+        chunks.swap(result);
+        return *this;
+    }
+
+    HybridSet &operator&=(HybridSet const &other) {
+        auto out = chunks.begin();
+        auto i2 = other.chunks.begin(), e2 = other.chunks.end();
+        for (auto &chunk : chunks) {
+            while (i2 != e2 && i2->key < chunk.key)
+                ++i2;
+            if (i2 == e2)
+                break;
+            if (i2->key != chunk.key)
+                continue;
+            chunk.intersect(*i2);
+            if (!chunk.count)
+                continue;
+            if (&*out != &chunk)
+                *out = std::move(chunk);
+            ++out;
+        }
+        chunks.erase(out, chunks.end());
+        return *this;
+    }
+
+    // Test if two sets have intersection
+    [[nodiscard]] bool hasIntersection(HybridSet const &other) const {
+        auto i2 = other.chunks.begin(), e2 = other.chunks.end();
+        for (auto const &chunk : chunks) {
+            while (i2 != e2 && i2->key < chunk.key)
+                ++i2;
+            if (i2 == e2)
+                return false;
+            if (i2->key != chunk.key)
+                continue;
+            auto const &[small, large] = chunk.count < i2->count
+                                             ? std::tie(chunk, *i2)
+                                             : std::tie(*i2, chunk);
+            if (small.dense() && kernels::intersects(small.bitmap.data(),
+                                                     large.bitmap.data(),
+                                                     bitmap_words))
+                return true;
+            if (!small.dense()) {
+                for (auto low : small.array) {
+                    if (large.contains(low))
+                        return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Calls f(element) in ascending order.
+    template <class F> void forEach(F &&f) const {
+        for (auto const &chunk : chunks) {
+            size_type base = chunk.key << chunk_bits;
+            chunk.forEach(
+                [&f, base](size_type low) { f(static_cast<T>(base + low)); });
+        }
+    }
+
+    // Calls f(element) for each element of both sets in ascending order,
+    // without building the intersection.
+    template <class F>
+    void forEachIntersection(HybridSet const &other, F &&f) const {
+        auto i2 = other.chunks.begin(), e2 = other.chunks.end();
+        for (auto const &chunk : chunks) {
+            while (i2 != e2 && i2->key < chunk.key)
+                ++i2;
+            if (i2 == e2)
+                return;
+            if (i2->key != chunk.key)
+                continue;
+            size_type base = chunk.key << chunk_bits;
+            if (chunk.dense() && i2->dense()) {
+                for (size_type i = 0; i < bitmap_words; ++i) {
+                    for (word x = chunk.bitmap[i] & i2->bitmap[i]; x;
+                         x &= x - 1)
+                        f(static_cast<T>(base + i * word_bits + ctz(x)));
+                }
+                continue;
+            }
+            // Probe the other chunk with the elements of the smaller one.
+            auto const &[small, large] = chunk.count < i2->count
+                                             ? std::tie(chunk, *i2)
+                                             : std::tie(*i2, chunk);
+            small.forEach([&](size_type low) {
+                if (large.contains(static_cast<low_type>(low)))
+                    f(static_cast<T>(base + low));
+            });
+        }
+    }
+
+    // Dump this set in human-readable format.
+    [[nodiscard]] std::string dump() const {
+        std::string s = "{";
+        bool flag = false;
+        for (auto i : *this) {
+            if (flag)
+                s += ", ";
+            s += std::to_string(i);
+            flag = true;
+        }
+        s += '}';
+        return s;
+    }
+
+    struct Iterator {
+      private:
+        HybridSet const *set;
+        size_type chunk;
+        // Index in the array, or the bit position in the bitmap.
+        size_type pos;
+
+        // Moves to the first element at or after (chunk, pos).
+        void settle() {
+            auto const &chunks = set->chunks;
+            for (; chunk < chunks.size(); ++chunk, pos = 0) {
+                auto const &c = chunks[chunk];
+                if (!c.dense()) {
+                    if (pos < c.array.size())
+                        return;
+                } else if ((pos = c.findBit(pos)) != npos) {
+                    return;
+                }
+            }
+            pos = 0;
+        }
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+
+        explicit Iterator(HybridSet const &_set, bool end = false)
+            : set(&_set), chunk(end ? _set.chunks.size() : 0), pos(0) {
+            if (!end)
+                settle();
+        }
+
+        Iterator &operator++() {
+            ++pos;
+            settle();
+            return *this;
+        }
+
+        value_type operator*() const {
+            auto const &c = set->chunks[chunk];
+            size_type low = c.dense() ? pos : c.array[pos];
+            return static_cast<T>((c.key << chunk_bits) + low);
+        }
+
+        friend bool operator!=(const Iterator &a, const Iterator &b) {
+            return a.set != b.set || a.chunk != b.chunk || a.pos != b.pos;
+        }
+    };
+
+    [[nodiscard]] Iterator begin() const { return Iterator(*this); }
+    [[nodiscard]] Iterator end() const { return Iterator(*this, true); }
+};
+
+} // namespace util
+
+namespace std {
+template <class T> struct hash<util::HybridSet<T>> {
+    std::size_t operator()(util::HybridSet<T> const &set) const {
+        std::size_t res = 17;
+        for (auto const &chunk : set.chunks) {
+            res = res * 31 + chunk.key;
+            if (chunk.dense()) {
+                res = res * 31 +
+                      util::kernels::hash(chunk.bitmap.data(),
+                                          util::HybridSet<T>::bitmap_words);
+            } else {
+                for (auto low : chunk.array)
+                    res = res * 31 + low;
+            }
+        }
+        return res;
+    }
+};
+} // namespace std
+
+#endif
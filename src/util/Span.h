@@ -0,0 +1,60 @@
+#ifndef LRPARSER_SPAN_H
+#define LRPARSER_SPAN_H
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace util {
+
+// A non-owning view of a contiguous range, similar to C++20 std::span. The
+// viewed storage must outlive the span.
+template <class T> class Span {
+  public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = ::size_t;
+    using iterator = T *;
+
+    Span() = default;
+    Span(T *data, size_type size) : m_data(data), m_size(size) {}
+
+    template <class U, class Alloc,
+              typename std::enable_if_t<
+                  std::is_convertible_v<U (*)[], T (*)[]>, int> = 0>
+    Span(std::vector<U, Alloc> &vec) : m_data(vec.data()), m_size(vec.size()) {}
+
+    template <class U, class Alloc,
+              typename std::enable_if_t<
+                  std::is_convertible_v<const U (*)[], T (*)[]>, int> = 0>
+    Span(std::vector<U, Alloc> const &vec)
+        : m_data(vec.data()), m_size(vec.size()) {}
+
+    [[nodiscard]] T *data() const { return m_data; }
+    [[nodiscard]] size_type size() const { return m_size; }
+    [[nodiscard]] bool empty() const { return m_size == 0; }
+    [[nodiscard]] iterator begin() const { return m_data; }
+    [[nodiscard]] iterator end() const { return m_data + m_size; }
+
+    T &operator[](size_type i) const {
+        assert(i < m_size);
+        return m_data[i];
+    }
+
+    [[nodiscard]] T &front() const { return (*this)[0]; }
+    [[nodiscard]] T &back() const { return (*this)[m_size - 1]; }
+
+    [[nodiscard]] Span subspan(size_type offset, size_type count) const {
+        assert(offset + count <= m_size);
+        return {m_data + offset, count};
+    }
+
+  private:
+    T *m_data = nullptr;
+    size_type m_size = 0;
+};
+
+} // namespace util
+
+#endif
@@ -21,7 +21,7 @@ template <class T> class TreeSet : public std::set<int> {
 
     TreeSet() = default;
 
-    explicit TreeSet(size_type N) {}
+    explicit TreeSet(size_type /*N*/) {}
 
     void remove(T N_) { std::set<element_type>::erase(N_); }
 
@@ -29,10 +29,11 @@ template <class T> class TreeSet : public std::set<int> {
 
     bool contains(T N_) const { return std::set<element_type>::count(N_) != 0; }
 
+    // std::set has no push_back(), so results are built with an inserter.
     TreeSet &operator|=(TreeSet const &other) {
         TreeSet result;
         std::set_union(this->begin(), this->end(), other.begin(),
-                       other.end(), std::back_inserter(result));
+                       other.end(), std::inserter(result, result.end()));
         this->swap(result);
         return *this;
     }
@@ -40,10 +41,32 @@ template <class T> class TreeSet : public std::set<int> {
     TreeSet &operator&=(TreeSet const &other) {
         TreeSet result;
         std::set_intersection(this->begin(), this->end(), other.begin(),
-                              other.end(), std::back_inserter(result));
+                              other.end(), std::inserter(result, result.end()));
         this->swap(result);
         return *this;
     }
+
+    template <class F> void forEach(F &&f) const {
+        for (auto e : *this)
+            f(static_cast<T>(e));
+    }
+
+    // Calls f(element) for each element in both sets, in ascending order.
+    template <class F>
+    void forEachIntersection(TreeSet const &other, F &&f) const {
+        auto i1 = this->begin(), i2 = other.begin();
+        while (i1 != this->end() && i2 != other.end()) {
+            if (*i1 < *i2) {
+                ++i1;
+            } else if (*i2 < *i1) {
+                ++i2;
+            } else {
+                f(static_cast<T>(*i1));
+                ++i1;
+                ++i2;
+            }
+        }
+    }
 };
 
 }